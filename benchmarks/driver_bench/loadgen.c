@@ -0,0 +1,314 @@
+// User-space load generator for the sample character drivers.
+//
+// Every thread opens the device on its own file descriptor and issues one
+// kind of request in a loop for a fixed time, timing each call. The totals
+// and a log2 latency histogram are printed at the end, as text or as one
+// JSON object with --json (see run_bench.py).
+//
+//   loadgen --device /dev/good_driver --op read --threads 4 --size 4096 --seconds 5
+//
+// Operations:
+//   read    pread(fd, buf, size, 0)
+//   write   pwrite(fd, buf, size, 0)
+//   llseek  lseek(fd, 0, SEEK_SET)
+//   rw      pread, with --write-pct percent of the calls replaced by pwrite
+//
+// Reads are served from what a single pwrite of --size bytes stored before
+// the run. A call that fails stops its thread and is reported.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define HISTOGRAM_BUCKETS 48 // Bucket b counts latencies in [2^(b-1), 2^b) ns
+
+enum op { OP_READ, OP_WRITE, OP_LLSEEK, OP_RW };
+
+static const char *const op_names[] = { "read", "write", "llseek", "rw" };
+
+struct options {
+    const char *device;
+    enum op op;
+    int threads;
+    size_t size;
+    double seconds;
+    int write_pct;
+    int json;
+};
+
+struct thread_result {
+    uint64_t ops;
+    uint64_t bytes;
+    uint64_t latency_sum_ns;
+    uint64_t latency_max_ns;
+    uint64_t histogram[HISTOGRAM_BUCKETS];
+    int error; // errno of the call that stopped the thread, or 0
+};
+
+struct worker {
+    pthread_t thread;
+    const struct options *options;
+    uint64_t deadline_ns;
+    unsigned int seed;
+    struct thread_result result;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int bucket_of(uint64_t ns) {
+    int bucket = ns ? 64 - __builtin_clzll(ns) : 0;
+
+    return bucket < HISTOGRAM_BUCKETS ? bucket : HISTOGRAM_BUCKETS - 1;
+}
+
+static void *run_worker(void *arg) {
+    struct worker *worker = arg;
+    const struct options *options = worker->options;
+    struct thread_result *result = &worker->result;
+    char *buffer;
+    int fd;
+
+    buffer = malloc(options->size ? options->size : 1);
+    fd = open(options->device, O_RDWR);
+    if (!buffer || fd < 0) {
+        result->error = errno ? errno : ENOMEM;
+        free(buffer);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    memset(buffer, 'x', options->size);
+
+    // Check the clock once per batch rather than per call
+    while (now_ns() < worker->deadline_ns) {
+        for (int i = 0; i < 64; i++) {
+            enum op op = options->op;
+            uint64_t start, elapsed;
+            ssize_t ret;
+
+            if (op == OP_RW)
+                op = (int)(rand_r(&worker->seed) % 100) < options->write_pct ? OP_WRITE : OP_READ;
+
+            start = now_ns();
+            if (op == OP_READ)
+                ret = pread(fd, buffer, options->size, 0);
+            else if (op == OP_WRITE)
+                ret = pwrite(fd, buffer, options->size, 0);
+            else
+                ret = lseek(fd, 0, SEEK_SET);
+            elapsed = now_ns() - start;
+
+            if (ret < 0) {
+                result->error = errno;
+                goto out;
+            }
+            result->ops++;
+            if (op != OP_LLSEEK)
+                result->bytes += (uint64_t)ret;
+            result->latency_sum_ns += elapsed;
+            if (elapsed > result->latency_max_ns)
+                result->latency_max_ns = elapsed;
+            result->histogram[bucket_of(elapsed)]++;
+        }
+    }
+
+out:
+    close(fd);
+    free(buffer);
+    return NULL;
+}
+
+// Upper bound of the bucket holding the given fraction of all calls
+static uint64_t percentile_ns(const uint64_t *histogram, uint64_t total, double fraction) {
+    uint64_t seen = 0;
+
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram[bucket];
+        if (total && seen >= (uint64_t)(fraction * (double)total + 0.5))
+            return (uint64_t)1 << bucket;
+    }
+    return (uint64_t)1 << (HISTOGRAM_BUCKETS - 1);
+}
+
+static int prefill(const struct options *options) {
+    char *buffer = malloc(options->size ? options->size : 1);
+    int fd = open(options->device, O_RDWR);
+    int ret = 0;
+
+    if (!buffer || fd < 0) {
+        ret = -1;
+    } else {
+        memset(buffer, 'x', options->size);
+        if (pwrite(fd, buffer, options->size, 0) < 0)
+            ret = -1;
+    }
+    if (fd >= 0)
+        close(fd);
+    free(buffer);
+    return ret;
+}
+
+static void report(const struct options *options, const struct thread_result *total, double elapsed_s,
+                   int error) {
+    double ops_per_sec = elapsed_s > 0 ? (double)total->ops / elapsed_s : 0;
+    double mb_per_sec = elapsed_s > 0 ? (double)total->bytes / elapsed_s / 1e6 : 0;
+    double mean_ns = total->ops ? (double)total->latency_sum_ns / (double)total->ops : 0;
+    uint64_t p50 = percentile_ns(total->histogram, total->ops, 0.50);
+    uint64_t p90 = percentile_ns(total->histogram, total->ops, 0.90);
+    uint64_t p99 = percentile_ns(total->histogram, total->ops, 0.99);
+
+    if (!options->json) {
+        printf("%s %s: %d threads, %zu-byte I/O, %.2f s\n", options->device, op_names[options->op],
+               options->threads, options->size, elapsed_s);
+        printf("  %.0f ops/s, %.2f MB/s\n", ops_per_sec, mb_per_sec);
+        printf("  latency mean %.0f ns, p50 < %llu ns, p90 < %llu ns, p99 < %llu ns, max %llu ns\n", mean_ns,
+               (unsigned long long)p50, (unsigned long long)p90, (unsigned long long)p99,
+               (unsigned long long)total->latency_max_ns);
+        for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+            if (total->histogram[bucket])
+                printf("  < %12llu ns  %llu\n", (unsigned long long)1 << bucket,
+                       (unsigned long long)total->histogram[bucket]);
+        }
+        if (error)
+            printf("  stopped early: %s\n", strerror(error));
+        return;
+    }
+
+    printf("{\"device\": \"%s\", \"op\": \"%s\", \"threads\": %d, \"size\": %zu, \"seconds\": %.3f, "
+           "\"ops\": %llu, \"bytes\": %llu, \"ops_per_sec\": %.1f, \"mb_per_sec\": %.3f, "
+           "\"latency_ns\": {\"mean\": %.0f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu}, "
+           "\"histogram\": [",
+           options->device, op_names[options->op], options->threads, options->size, elapsed_s,
+           (unsigned long long)total->ops, (unsigned long long)total->bytes, ops_per_sec, mb_per_sec, mean_ns,
+           (unsigned long long)p50, (unsigned long long)p90, (unsigned long long)p99,
+           (unsigned long long)total->latency_max_ns);
+    for (int bucket = 0, first = 1; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        if (total->histogram[bucket]) {
+            printf("%s[%llu, %llu]", first ? "" : ", ", (unsigned long long)1 << bucket,
+                   (unsigned long long)total->histogram[bucket]);
+            first = 0;
+        }
+    }
+    printf("], \"error\": %s%s%s}\n", error ? "\"" : "", error ? strerror(error) : "null", error ? "\"" : "");
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s --device PATH [--op read|write|llseek|rw] [--threads N] [--size BYTES]\n"
+            "       [--seconds S] [--write-pct P] [--json]\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    static const struct option long_options[] = {
+        { "device", required_argument, NULL, 'd' },
+        { "op", required_argument, NULL, 'o' },
+        { "threads", required_argument, NULL, 't' },
+        { "size", required_argument, NULL, 's' },
+        { "seconds", required_argument, NULL, 'S' },
+        { "write-pct", required_argument, NULL, 'w' },
+        { "json", no_argument, NULL, 'j' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    struct options options = { NULL, OP_READ, 1, 4096, 5.0, 10, 0 };
+    struct thread_result total = { 0 };
+    struct worker *workers;
+    uint64_t start;
+    double elapsed_s;
+    int opt, error = 0;
+
+    while ((opt = getopt_long(argc, argv, "d:o:t:s:S:w:jh", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
+            options.device = optarg;
+            break;
+        case 'o':
+            for (options.op = OP_READ; options.op <= OP_RW; options.op++) {
+                if (strcmp(optarg, op_names[options.op]) == 0)
+                    break;
+            }
+            if (options.op > OP_RW) {
+                fprintf(stderr, "Error: unknown operation %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 't':
+            options.threads = atoi(optarg);
+            break;
+        case 's':
+            options.size = strtoul(optarg, NULL, 0);
+            break;
+        case 'S':
+            options.seconds = atof(optarg);
+            break;
+        case 'w':
+            options.write_pct = atoi(optarg);
+            break;
+        case 'j':
+            options.json = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 2;
+        }
+    }
+    if (!options.device || options.threads < 1 || options.seconds <= 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (options.op != OP_WRITE && options.op != OP_LLSEEK && prefill(&options) < 0) {
+        fprintf(stderr, "Error: cannot write to %s: %s\n", options.device, strerror(errno));
+        return 1;
+    }
+
+    workers = calloc((size_t)options.threads, sizeof(*workers));
+    if (!workers) {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    start = now_ns();
+    for (int i = 0; i < options.threads; i++) {
+        workers[i].options = &options;
+        workers[i].deadline_ns = start + (uint64_t)(options.seconds * 1e9);
+        workers[i].seed = (unsigned int)i + 1;
+        if (pthread_create(&workers[i].thread, NULL, run_worker, &workers[i]) != 0) {
+            fprintf(stderr, "Error: cannot start thread %d\n", i);
+            return 1;
+        }
+    }
+    for (int i = 0; i < options.threads; i++) {
+        const struct thread_result *result = &workers[i].result;
+
+        pthread_join(workers[i].thread, NULL);
+        total.ops += result->ops;
+        total.bytes += result->bytes;
+        total.latency_sum_ns += result->latency_sum_ns;
+        if (result->latency_max_ns > total.latency_max_ns)
+            total.latency_max_ns = result->latency_max_ns;
+        for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++)
+            total.histogram[bucket] += result->histogram[bucket];
+        if (result->error && !error)
+            error = result->error;
+    }
+    elapsed_s = (double)(now_ns() - start) / 1e9;
+
+    report(&options, &total, elapsed_s, error);
+    free(workers);
+    return error ? 1 : 0;
+}
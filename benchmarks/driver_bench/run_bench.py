@@ -0,0 +1,165 @@
+import os
+import sys
+import json
+import time
+import argparse
+import subprocess
+
+# Loads each reference driver, drives it with loadgen over a matrix of
+# operations, thread counts and I/O sizes, and unloads it again. Needs root,
+# the modules built with `make modules` and loadgen with `make loadgen`.
+#
+# The report lists every run and, when compared against a baseline report,
+# the runs that got slower. Passing the report to script.py --bench-results
+# turns those regressions into performance findings on the driver's source.
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+ENGINE_DIR = os.path.join(BENCH_DIR, '..', '..', 'code-evaluation-engine')
+LOADGEN = os.path.join(BENCH_DIR, 'loadgen')
+
+# Module parameter sets are benchmarked as separate variants. bad_driver is
+# left out on purpose: it leaks its buffer on every write and is not safe to
+# load on a machine you care about.
+DRIVERS = {
+    "good_driver": {"source": "good_driver.c", "device": "/dev/good_driver", "variants": ["", "read_mostly=1"]},
+    "mid_driver": {"source": "mid_driver.c", "device": "/dev/subtle_bad_driver", "variants": [""]},
+}
+
+DEFAULT_OPS = ("read", "write", "llseek", "rw")
+DEFAULT_THREADS = (1, 4)
+DEFAULT_SIZES = (64, 256)
+
+
+def _ints(value):
+    return [int(item) for item in value.split(',') if item]
+
+
+def _wait_for_device(path, timeout=5.0):
+    # udev creates the node asynchronously after insmod returns
+    deadline = time.monotonic() + timeout
+    while not os.path.exists(path):
+        if time.monotonic() > deadline:
+            return False
+        time.sleep(0.05)
+    return True
+
+
+def load_module(module, params):
+    path = os.path.join(ENGINE_DIR, module + ".ko")
+    result = subprocess.run(["insmod", path] + params.split(), capture_output=True, text=True)
+    if result.returncode != 0:
+        print(f"Error: insmod {path} {params} failed: {result.stderr.strip()}")
+        return False
+    return True
+
+
+def unload_module(module):
+    result = subprocess.run(["rmmod", module], capture_output=True, text=True)
+    if result.returncode != 0:
+        print(f"Warning: rmmod {module} failed: {result.stderr.strip()}")
+
+
+def run_loadgen(device, op, threads, size, seconds, write_pct):
+    command = [LOADGEN, "--device", device, "--op", op, "--threads", str(threads), "--size", str(size),
+               "--seconds", str(seconds), "--write-pct", str(write_pct), "--json"]
+    result = subprocess.run(command, capture_output=True, text=True)
+    try:
+        return json.loads(result.stdout)
+    except json.JSONDecodeError:
+        print(f"Error: loadgen failed on {device} ({op}, {threads} threads, {size} bytes): "
+              f"{result.stderr.strip()}")
+        return None
+
+
+def run_key(run):
+    # Identifies a run across reports
+    return (run["driver"], run["params"], run["op"], run["threads"], run["size"])
+
+
+def find_regressions(runs, baseline_runs, tolerance):
+    # Runs whose throughput fell or whose p99 latency grew by more than tolerance
+    baseline = {run_key(run): run for run in baseline_runs}
+    regressions = []
+    for run in runs:
+        before = baseline.get(run_key(run))
+        if before is None:
+            continue
+        metrics = []
+        if before["ops_per_sec"] > 0 and run["ops_per_sec"] < before["ops_per_sec"] * (1 - tolerance):
+            metrics.append(("ops_per_sec", before["ops_per_sec"], run["ops_per_sec"]))
+        if before["latency_ns"]["p99"] > 0 and run["latency_ns"]["p99"] > before["latency_ns"]["p99"] * (1 + tolerance):
+            metrics.append(("p99_ns", before["latency_ns"]["p99"], run["latency_ns"]["p99"]))
+        for metric, old, new in metrics:
+            regressions.append({"driver": run["driver"], "source": run["source"], "params": run["params"],
+                                "op": run["op"], "threads": run["threads"], "size": run["size"],
+                                "metric": metric, "baseline": old, "current": new})
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the reference drivers with loadgen.")
+    parser.add_argument("--drivers", default=",".join(DRIVERS), help="comma-separated drivers to run")
+    parser.add_argument("--ops", default=",".join(DEFAULT_OPS))
+    parser.add_argument("--threads", default=",".join(map(str, DEFAULT_THREADS)))
+    parser.add_argument("--sizes", default=",".join(map(str, DEFAULT_SIZES)), help="I/O sizes in bytes")
+    parser.add_argument("--seconds", type=float, default=3.0, help="duration of each run (default: 3)")
+    parser.add_argument("--write-pct", type=int, default=10, help="share of writes in the rw mix (default: 10)")
+    parser.add_argument("--baseline", metavar="PATH", default=None, help="earlier report to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.10,
+                        help="relative change treated as noise when comparing (default: 0.10)")
+    parser.add_argument("--json", metavar="PATH", default="driver_bench.json",
+                        help="where to write the report (default: driver_bench.json)")
+    args = parser.parse_args()
+
+    if os.geteuid() != 0:
+        print("Error: loading modules needs root.")
+        sys.exit(1)
+    if not os.access(LOADGEN, os.X_OK):
+        print(f"Error: {LOADGEN} not found; run `make loadgen` first.")
+        sys.exit(1)
+
+    config = {"ops": args.ops.split(','), "threads": _ints(args.threads), "sizes": _ints(args.sizes),
+              "seconds": args.seconds, "write_pct": args.write_pct, "kernel": os.uname().release}
+    runs = []
+    for driver in args.drivers.split(','):
+        spec = DRIVERS.get(driver)
+        if spec is None:
+            print(f"Warning: unknown driver {driver}, skipping.")
+            continue
+        for params in spec["variants"]:
+            if not load_module(driver, params):
+                continue
+            try:
+                if not _wait_for_device(spec["device"]):
+                    print(f"Error: {spec['device']} did not appear after loading {driver}.")
+                    continue
+                for op in config["ops"]:
+                    for threads in config["threads"]:
+                        for size in config["sizes"]:
+                            result = run_loadgen(spec["device"], op, threads, size, args.seconds, args.write_pct)
+                            if result is None:
+                                continue
+                            result.update(driver=driver, source=spec["source"], params=params)
+                            runs.append(result)
+                            print(f"{driver:12} {params or '-':14} {op:7} {threads:3}t {size:6}B  "
+                                  f"{result['ops_per_sec']:12.0f} ops/s {result['mb_per_sec']:9.2f} MB/s  "
+                                  f"p99 < {result['latency_ns']['p99']} ns")
+            finally:
+                unload_module(driver)
+
+    regressions = []
+    if args.baseline:
+        with open(args.baseline, 'r') as f:
+            regressions = find_regressions(runs, json.load(f).get("runs", []), args.tolerance)
+        for regression in regressions:
+            print(f"Regression: {regression['driver']} {regression['params'] or '-'} {regression['op']} "
+                  f"{regression['threads']}t {regression['size']}B {regression['metric']} "
+                  f"{regression['baseline']} -> {regression['current']}")
+
+    with open(args.json, 'w') as f:
+        json.dump({"config": config, "runs": runs, "regressions": regressions}, f, indent=2)
+    print(f"Wrote {len(runs)} runs and {len(regressions)} regressions to {args.json}")
+
+
+if __name__ == "__main__":
+    main()
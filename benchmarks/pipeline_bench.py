@@ -0,0 +1,214 @@
+import os
+import re
+import sys
+import json
+import time
+import hashlib
+import argparse
+import resource
+import shutil
+import tempfile
+import importlib.util
+import multiprocessing
+
+# Benchmarks the full orchestration pipeline over the bundled good/mid/bad
+# drivers, optionally scaled up with synthetic variants. cppcheck runs for
+# real; the Gemini client is replaced by a deterministic stand-in with a
+# fixed simulated latency, so results depend only on the orchestrator.
+
+REPO_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+ENGINE_DIR = os.path.join(REPO_DIR, 'code-evaluation-engine')
+BUNDLED_DRIVERS = ('good_driver.c', 'mid_driver.c', 'bad_driver.c')
+
+sys.path.append(ENGINE_DIR)
+import qualitative
+import quantitative
+import profiling
+
+_spec = importlib.util.spec_from_file_location("pipeline", os.path.join(REPO_DIR, "script.py"))
+pipeline = importlib.util.module_from_spec(_spec)
+# Registered so worker functions from script.py can be pickled by reference
+sys.modules["pipeline"] = pipeline
+_spec.loader.exec_module(pipeline)
+
+
+class _MockResponse:
+    def __init__(self, text):
+        self.text = text
+        self.usage_metadata = None
+
+
+class _MockModels:
+    # Scores are a hash of the request, so the same input always gets the same verdict
+
+    def __init__(self, latency):
+        self.latency = latency
+
+    def _score(self, text):
+        return int(hashlib.sha256(text.encode('utf-8')).hexdigest(), 16) % 101
+
+    def generate_content(self, model, contents, config=None):
+        time.sleep(self.latency)
+        text = contents if isinstance(contents, str) else json.dumps(contents)
+        schema = getattr(config, "response_schema", None) if config is not None else None
+        if schema:
+            score = self._score(text) / 100.0
+            return _MockResponse(json.dumps({pillar: {"category_score": score, "summary": ""}
+                                             for pillar in schema["properties"]}))
+        file_ids = re.findall(r"=== FILE (F\d+)", text)
+        if file_ids:
+            return _MockResponse(json.dumps({"files": [{"id": file_id, "score": self._score(text + file_id)}
+                                                       for file_id in file_ids]}))
+        return _MockResponse(f"{{}}\nscore: {self._score(text)}/100")
+
+    def generate_content_stream(self, model, contents, config=None):
+        response = self.generate_content(model, contents, config)
+        for start in range(0, len(response.text), 16):
+            yield _MockResponse(response.text[start:start + 16])
+
+
+class _MockCaches:
+    def create(self, model, config):
+        raise RuntimeError("context caching is not mocked")
+
+
+class MockClient:
+    def __init__(self, latency):
+        self.models = _MockModels(latency)
+        self.caches = _MockCaches()
+
+
+def install_mock_llm(latency):
+    client = MockClient(latency)
+    qualitative.get_client = lambda: client
+
+
+_INCLUDE_LINE = re.compile(r'^[ \t]*#[ \t]*include\b.*$', re.MULTILINE)
+_DRIVER_IDENTIFIER = re.compile(r"\b(good|subtle|bad)_(\w*)")
+
+
+def _rename_identifiers(source, index, keep=frozenset()):
+    # #include lines keep their file names so the copied headers still
+    # resolve, and names in keep (declared by those headers) stay as they are
+    def rename(match):
+        if match.group(0) in keep:
+            return match.group(0)
+        return f"{match.group(1)}{index}_{match.group(2)}"
+
+    parts = []
+    position = 0
+    for include in _INCLUDE_LINE.finditer(source):
+        parts.append(_DRIVER_IDENTIFIER.sub(rename, source[position:include.start()]))
+        parts.append(include.group(0))
+        position = include.end()
+    parts.append(_DRIVER_IDENTIFIER.sub(rename, source[position:]))
+    return "".join(parts)
+
+
+def generate_variants(count, out_dir):
+    # Deterministic variants of the bundled drivers: each copy gets its own
+    # identifier suffix and header comment, so every file hashes differently.
+    # The local headers they include are copied alongside, unchanged.
+    sources = []
+    header_names = set()
+    for name in BUNDLED_DRIVERS:
+        path = os.path.join(ENGINE_DIR, name)
+        with open(path, 'r') as f:
+            sources.append((name, f.read()))
+        for header in quantitative.local_includes(path):
+            target = os.path.join(out_dir, os.path.relpath(header, ENGINE_DIR))
+            os.makedirs(os.path.dirname(target), exist_ok=True)
+            shutil.copyfile(header, target)
+            with open(header, 'r') as f:
+                header_names.update(match.group(0) for match in _DRIVER_IDENTIFIER.finditer(f.read()))
+
+    paths = []
+    for index in range(count):
+        name, source = sources[index % len(sources)]
+        variant = _rename_identifiers(source, index, header_names)
+        variant = f"/* synthetic variant {index} of {name} */\n" + variant
+        path = os.path.join(out_dir, f"variant_{index:06d}_{name}")
+        with open(path, 'w') as f:
+            f.write(variant)
+        paths.append(path)
+    return paths
+
+
+def peak_rss_mb():
+    # ru_maxrss is in KiB on Linux; children covers the worker processes
+    own = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    children = resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss
+    return {"orchestrator": own / 1024.0, "largest_worker": children / 1024.0}
+
+
+def run_benchmark(sources, **options):
+    profiles = []
+    failures = 0
+    start = time.perf_counter()
+    for result in pipeline._run_pool(sources, profile=True, **options):
+        if "error" in result:
+            failures += 1
+        else:
+            profiles.append(result["profile"])
+    wall = time.perf_counter() - start
+    return {
+        "files": len(sources),
+        "failures": failures,
+        "wall_s": wall,
+        "files_per_sec": len(sources) / wall if wall > 0 else 0.0,
+        "peak_rss_mb": peak_rss_mb(),
+        "stages": profiling.summarize(profiles)
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark the analysis pipeline with a mocked LLM.")
+    parser.add_argument("--variants", type=int, default=0,
+                        help="benchmark N synthetic variants instead of the three bundled drivers")
+    parser.add_argument("--llm-latency", type=float, default=0.5,
+                        help="simulated seconds per LLM request (default: 0.5)")
+    parser.add_argument("--workers", type=int, default=None)
+    parser.add_argument("--cppcheck-batch", type=int, default=0)
+    parser.add_argument("--cppcheck-jobs", type=int, default=None)
+    parser.add_argument("--llm-batch", type=int, default=0)
+    parser.add_argument("--sequential", action="store_true")
+    parser.add_argument("--check-profile", choices=sorted(quantitative.CHECK_PROFILES), default="all")
+    parser.add_argument("--kernel-dir", default=None)
+    parser.add_argument("--cppcheck-build-dir", default=None)
+    parser.add_argument("--triage-below", type=float, default=None)
+    parser.add_argument("--triage-above", type=float, default=None)
+    parser.add_argument("--json", metavar="PATH", default=None, help="also write the report as JSON to PATH")
+    args = parser.parse_args()
+
+    # Worker processes must inherit the mocked client
+    multiprocessing.set_start_method("fork", force=True)
+    install_mock_llm(args.llm_latency)
+    quantitative.configure_cppcheck(args.check_profile, args.kernel_dir, build_dir=args.cppcheck_build_dir)
+    if args.cppcheck_batch and quantitative.has_whole_program_checks():
+        print("--cppcheck-batch needs --check-profile scoring, as in script.py")
+        sys.exit(1)
+
+    options = dict(workers=args.workers, concurrent=not args.sequential, cppcheck_batch=args.cppcheck_batch,
+                   cppcheck_jobs=args.cppcheck_jobs, llm_batch=args.llm_batch,
+                   triage_below=args.triage_below, triage_above=args.triage_above)
+    with tempfile.TemporaryDirectory(prefix="pipeline_bench_") as corpus_dir:
+        if args.variants > 0:
+            sources = generate_variants(args.variants, corpus_dir)
+        else:
+            sources = [os.path.abspath(os.path.join(ENGINE_DIR, name)) for name in BUNDLED_DRIVERS]
+        report = run_benchmark(sources, **options)
+
+    report["options"] = dict(options, variants=args.variants, llm_latency=args.llm_latency,
+                             check_profile=args.check_profile)
+    print(f"files: {report['files']}  failures: {report['failures']}  wall: {report['wall_s']:.2f}s  "
+          f"files/sec: {report['files_per_sec']:.2f}")
+    print(f"peak RSS: orchestrator {report['peak_rss_mb']['orchestrator']:.1f} MiB, "
+          f"largest worker {report['peak_rss_mb']['largest_worker']:.1f} MiB")
+    print(profiling.format_table(report["stages"]))
+    if args.json:
+        with open(args.json, 'w') as f:
+            json.dump(report, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
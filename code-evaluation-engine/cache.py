@@ -0,0 +1,92 @@
+import os
+import json
+import hashlib
+import tempfile
+from functools import lru_cache
+
+import quantitative
+import perfcheck
+from quantitative import cppcheck_version, cppcheck_flags, local_includes
+
+# Results are stored as JSON under <cache_dir>/<kind>/<hh>/<digest>.json, where the
+# digest covers every input that can change the result. Static and LLM results are
+# keyed separately so that editing the prompt does not invalidate cppcheck output.
+
+
+def _digest(*parts):
+    sha = hashlib.sha256()
+    for part in parts:
+        data = part if isinstance(part, bytes) else str(part).encode('utf-8')
+        sha.update(len(data).to_bytes(8, 'big'))
+        sha.update(data)
+    return sha.hexdigest()
+
+
+def _read_bytes(path):
+    with open(path, 'rb') as f:
+        return f.read()
+
+
+def cppcheck_cache_key(source_file, enable_checks=None):
+    # Covers the check profile and kernel setup, and the local headers the
+    # file includes; the kernel headers themselves are assumed stable for a
+    # given tree path
+    source_dir = os.path.dirname(os.path.abspath(source_file))
+    headers = [part for path in local_includes(source_file)
+               for part in (os.path.relpath(path, source_dir), _read_bytes(path))]
+    return _digest("cppcheck", _read_bytes(source_file), cppcheck_version(), " ".join(cppcheck_flags(enable_checks)),
+                   *headers)
+
+
+def llm_cache_key(source_file, prompt_template_path, model, variant=None):
+    # variant distinguishes judging modes that send a different request for the same prompt
+    parts = ["llm", _read_bytes(source_file), _read_bytes(prompt_template_path), model]
+    if variant:
+        parts.append(variant)
+    return _digest(*parts)
+
+
+def chunk_cache_key(unit_text, context, prompt_template_path, model, variant=None):
+    # Keyed on the unit's text and the shared context sent with it, so a
+    # function that did not change is reused across revisions as long as the
+    # structs, globals and fops table it was judged against did not either
+    parts = ["llm-chunk", unit_text, context, _read_bytes(prompt_template_path), model]
+    if variant:
+        parts.append(variant)
+    return _digest(*parts)
+
+
+def _entry_path(cache_dir, kind, key):
+    return os.path.join(cache_dir, kind, key[:2], key + ".json")
+
+
+def load_cached(cache_dir, kind, key):
+    try:
+        with open(_entry_path(cache_dir, kind, key), 'r') as f:
+            return json.load(f)
+    except (FileNotFoundError, json.JSONDecodeError):
+        return None
+
+
+def store_cached(cache_dir, kind, key, value):
+    path = _entry_path(cache_dir, kind, key)
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    # Write to a sibling temp file and rename so concurrent workers never see a partial entry
+    fd, tmp_path = tempfile.mkstemp(dir=os.path.dirname(path), suffix=".tmp")
+    with os.fdopen(fd, 'w') as f:
+        json.dump(value, f)
+    os.replace(tmp_path, path)
+
+
+@lru_cache(maxsize=None)
+def scoring_rules_version():
+    # Final scores also depend on the native checks and the weights, which
+    # are applied after the cppcheck cache; editing either invalidates them
+    return _digest(_read_bytes(perfcheck.__file__), _read_bytes(quantitative.__file__))
+
+
+def result_cache_key(source_file, prompt_template_path, model, enable_checks=None, variant=None):
+    # The benchmark regressions in effect become findings too, so they are part of the key
+    return _digest("result", cppcheck_cache_key(source_file, enable_checks),
+                   llm_cache_key(source_file, prompt_template_path, model, variant), scoring_rules_version(),
+                   json.dumps(perfcheck.benchmark_settings(), sort_keys=True))
@@ -0,0 +1,128 @@
+import re
+
+# Splits a C source into units the LLM can judge independently: one unit per
+# file_operations handler and module init/exit function, with the remaining
+# functions packed together up to a line budget. Everything outside function
+# bodies (includes, globals, structs, the fops table) is the shared context
+# sent alongside every unit.
+
+DEFAULT_MAX_CHUNK_LINES = 150
+
+_COMMENT_OR_STRING = re.compile(r'//[^\n]*|/\*.*?\*/|"(?:\\.|[^"\\\n])*"|\'(?:\\.|[^\'\\\n])*\'', re.DOTALL)
+_DIRECTIVE = re.compile(r'^[ \t]*#(?:[^\n]*\\\n)*[^\n]*', re.MULTILINE)
+_FOPS_TABLE = re.compile(r'struct\s+file_operations\s+(\w+)\s*=\s*\{([^}]*)\}')
+_FOPS_ENTRY = re.compile(r'\.\s*(\w+)\s*=\s*&?\s*(\w+)')
+_MODULE_HOOK = re.compile(r'\bmodule_(init|exit)\s*\(\s*(\w+)\s*\)')
+_FUNCTION_NAME = re.compile(r'(\w+)\s*\(')
+_NOT_FUNCTION_NAMES = ('if', 'for', 'while', 'switch', 'return', 'sizeof', '__attribute__')
+
+
+def _blank(match):
+    return re.sub(r'[^\n]', ' ', match.group(0))
+
+
+def mask_source(text):
+    # Blanks comments, literals and preprocessor lines (keeping newlines and
+    # length) so braces and semicolons inside them, such as a do { } while (0)
+    # macro body, are not mistaken for code structure
+    return _DIRECTIVE.sub(_blank, _COMMENT_OR_STRING.sub(_blank, text))
+
+
+def fops_tables(text):
+    # file_operations initializers as (table name, offset, {field: function})
+    masked = mask_source(text)
+    return [(table.group(1), table.start(), dict(_FOPS_ENTRY.findall(table.group(2))))
+            for table in _FOPS_TABLE.finditer(masked)]
+
+
+def handler_roles(text):
+    # {function name: role} for fops handlers ("read", "write", ...) and
+    # module init/exit functions
+    masked = mask_source(text)
+    roles = {}
+    for _, _, fields in fops_tables(text):
+        for field, function in fields.items():
+            if field != "owner":
+                roles[function] = field
+    for hook, function in _MODULE_HOOK.findall(masked):
+        roles[function] = hook
+    return roles
+
+
+def find_functions(text):
+    # Top-level function definitions as (name, start, end) character offsets.
+    # start is where the declaration header begins; comments above a function
+    # stay with the surrounding context
+    masked = mask_source(text)
+    functions = []
+    depth = 0
+    header_start = 0
+    body_start = None
+    for index, char in enumerate(masked):
+        if char == '{':
+            if depth == 0:
+                header = masked[header_start:index]
+                if header.rstrip().endswith(')'):
+                    body_start = index
+                else:
+                    body_start = None
+            depth += 1
+        elif char == '}':
+            depth = max(0, depth - 1)
+            if depth == 0:
+                if body_start is not None:
+                    header = masked[header_start:body_start]
+                    names = [name for name in _FUNCTION_NAME.findall(header) if name not in _NOT_FUNCTION_NAMES]
+                    if names:
+                        start = header_start + len(header) - len(header.lstrip())
+                        functions.append((names[0], start, index + 1))
+                    body_start = None
+                header_start = index + 1
+        elif depth == 0 and char == ';':
+            header_start = index + 1
+    return functions
+
+
+def split_source(text, max_chunk_lines=DEFAULT_MAX_CHUNK_LINES):
+    # Returns (context, units). Each unit is {"name", "functions", "text",
+    # "lines"}: handlers get a unit of their own and helpers are packed
+    # together in source order until max_chunk_lines is reached.
+    roles = handler_roles(text)
+    functions = find_functions(text)
+
+    context_parts = []
+    position = 0
+    for name, start, end in functions:
+        context_parts.append(text[position:start])
+        position = end
+    context_parts.append(text[position:])
+    context = re.sub(r'\n{3,}', '\n\n', "".join(context_parts)).strip()
+
+    units = []
+    helpers = []
+    for name, start, end in functions:
+        body = text[start:end]
+        if name in roles:
+            units.append({"name": f"{roles[name]}: {name}", "functions": [name], "text": body,
+                          "lines": body.count('\n') + 1})
+        else:
+            helpers.append((name, body))
+
+    pending = []
+    pending_lines = 0
+    for name, body in helpers:
+        lines = body.count('\n') + 1
+        if pending and pending_lines + lines > max_chunk_lines:
+            units.append(_helper_unit(pending))
+            pending, pending_lines = [], 0
+        pending.append((name, body))
+        pending_lines += lines
+    if pending:
+        units.append(_helper_unit(pending))
+    return context, units
+
+
+def _helper_unit(helpers):
+    body = "\n\n".join(text for _, text in helpers)
+    return {"name": "helpers: " + ", ".join(name for name, _ in helpers),
+            "functions": [name for name, _ in helpers], "text": body, "lines": body.count('\n') + 1}
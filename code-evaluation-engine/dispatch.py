@@ -0,0 +1,233 @@
+import os
+import json
+import hmac
+import time
+import threading
+import urllib.request
+from http.server import ThreadingHTTPServer, BaseHTTPRequestHandler
+
+from taskqueue import DEFAULT_LEASE_SECONDS
+from quantitative import local_includes
+
+# JSON-over-HTTP transport between the coordinator, which owns the task queue,
+# and workers on other nodes. Workers need no access to the coordinator's
+# files: a lease carries the source text, the local headers it includes, the
+# judging options and the static-stage settings, and the result is posted
+# back. Requests are plain HTTP; set ANALYZER_QUEUE_TOKEN to the same secret
+# on both sides to reject clients that do not know it.
+#
+#   POST /lease     {"worker"}                  -> {"task": {...} | null, "done": bool}
+#   POST /renew     {"id", "token"}             -> {"ok": bool}
+#   POST /complete  {"id", "token", "result"}   -> {"ok": bool}
+#   POST /fail      {"id", "token", "error"}    -> {"ok": bool}
+#   GET  /status                                -> task counts by state
+
+TOKEN_ENV = "ANALYZER_QUEUE_TOKEN"
+TOKEN_HEADER = "X-Queue-Token"
+REQUEST_TIMEOUT = 30
+
+
+def task_files(path):
+    # (root, {relative path: text}) of the source and its local headers,
+    # relative to the directory that holds them all, so a worker can lay
+    # them out the same way; a header that cannot be read is left out, as
+    # cppcheck would miss it here too. Raises OSError for the source itself.
+    paths = [path] + local_includes(path)
+    root = os.path.commonpath([os.path.dirname(os.path.abspath(item)) for item in paths])
+    files = {}
+    for item in paths:
+        try:
+            with open(item, 'r') as f:
+                files[os.path.relpath(item, root)] = f.read()
+        except OSError:
+            if item == path:
+                raise
+    return root, files
+
+
+class Coordinator:
+    # reuse(path) returns a stored result for an unchanged file, or None;
+    # such tasks are completed on the spot instead of being handed out. It is
+    # asked again at lease time, so a copy of a file finished meanwhile by
+    # another node is not analyzed twice. settings go out with every task and
+    # must be JSON-serializable. result_key(root, files, name) gives the
+    # result cache key of the files handed out; it is kept with the task, so
+    # its result is stored under the content that was actually analyzed.
+
+    def __init__(self, queue, options, lease_seconds=DEFAULT_LEASE_SECONDS, reuse=None, settings=None,
+                 result_key=None):
+        self.queue = queue
+        self.options = options
+        self.settings = settings
+        self.result_key = result_key
+        self.lease_seconds = lease_seconds
+        self.reuse = reuse
+        self.token = os.environ.get(TOKEN_ENV)
+        self._server = None
+
+    def settle_reusable(self):
+        # Completes every pending task that reuse() can answer, before any
+        # worker connects; returns how many were settled
+        if not self.reuse:
+            return 0
+        settled = 0
+        after_id = 0
+        while True:
+            page = self.queue.pending(after_id)
+            if not page:
+                return settled
+            for task_id, path in page:
+                cached = self.reuse(path)
+                if cached is not None and self.queue.reuse(task_id, dict(cached, file=path)):
+                    settled += 1
+            after_id = page[-1][0]
+
+    def _lease(self, body):
+        while True:
+            task = self.queue.lease(str(body.get("worker", "unknown")), self.lease_seconds)
+            if task is None:
+                return {"task": None, "done": self.queue.remaining() == 0}
+            cached = self.reuse(task["path"]) if self.reuse else None
+            if cached is not None:
+                self.queue.complete(task["id"], task["token"], dict(cached, file=task["path"]), reused=True)
+                continue
+            try:
+                root, files = task_files(task["path"])
+            except OSError as e:
+                # Missing or unreadable on the coordinator: no worker can do better
+                self.queue.complete(task["id"], task["token"], {"file": task["path"], "error": str(e)})
+                continue
+            name = os.path.relpath(os.path.abspath(task["path"]), root)
+            if self.result_key:
+                self.queue.set_result_key(task["id"], task["token"], self.result_key(root, files, name))
+            return {"task": dict(task, root=root, name=name, source=files.pop(name), headers=files,
+                                 options=self.options, settings=self.settings, lease_seconds=self.lease_seconds),
+                    "done": False}
+
+    def _renew(self, body):
+        return {"ok": self.queue.renew(body["id"], body["token"], self.lease_seconds)}
+
+    def _complete(self, body):
+        return {"ok": self.queue.complete(body["id"], body["token"], body["result"])}
+
+    def _fail(self, body):
+        return {"ok": self.queue.fail(body["id"], body["token"], str(body.get("error", "worker error")))}
+
+    def handle(self, method, path, body):
+        routes = {("POST", "/lease"): self._lease, ("POST", "/renew"): self._renew,
+                  ("POST", "/complete"): self._complete, ("POST", "/fail"): self._fail,
+                  ("GET", "/status"): lambda _: self.queue.counts()}
+        route = routes.get((method, path))
+        return route(body) if route else None
+
+    def start(self, host, port):
+        coordinator = self
+
+        class Handler(BaseHTTPRequestHandler):
+            def _respond(self, status, payload):
+                data = json.dumps(payload).encode('utf-8')
+                self.send_response(status)
+                self.send_header("Content-Type", "application/json")
+                self.send_header("Content-Length", str(len(data)))
+                self.end_headers()
+                self.wfile.write(data)
+
+            def _dispatch(self, method):
+                if coordinator.token and not hmac.compare_digest(self.headers.get(TOKEN_HEADER, ""),
+                                                                 coordinator.token):
+                    return self._respond(403, {"error": "bad queue token"})
+                try:
+                    length = int(self.headers.get("Content-Length", 0))
+                    body = json.loads(self.rfile.read(length)) if length else {}
+                    payload = coordinator.handle(method, self.path, body)
+                except (ValueError, KeyError) as e:
+                    return self._respond(400, {"error": str(e)})
+                if payload is None:
+                    return self._respond(404, {"error": f"no route {method} {self.path}"})
+                self._respond(200, payload)
+
+            def do_GET(self):
+                self._dispatch("GET")
+
+            def do_POST(self):
+                self._dispatch("POST")
+
+            def log_message(self, format, *args):
+                pass
+
+        self._server = ThreadingHTTPServer((host, port), Handler)
+        self._server.daemon_threads = True
+        threading.Thread(target=self._server.serve_forever, daemon=True).start()
+        return self._server.server_address
+
+    def stop(self):
+        if self._server:
+            self._server.shutdown()
+            self._server.server_close()
+
+
+def call(url, route, payload=None):
+    # One request to the coordinator at url; raises OSError (URLError) when
+    # it cannot be reached
+    data = json.dumps(payload).encode('utf-8') if payload is not None else None
+    request = urllib.request.Request(url.rstrip('/') + route, data=data, method="POST" if data else "GET",
+                                     headers={"Content-Type": "application/json"})
+    token = os.environ.get(TOKEN_ENV)
+    if token:
+        request.add_header(TOKEN_HEADER, token)
+    with urllib.request.urlopen(request, timeout=REQUEST_TIMEOUT) as response:
+        return json.loads(response.read())
+
+
+class LeaseKeeper:
+    # Renews a lease in the background while the task runs, at a third of
+    # the lease period; lost is set once the coordinator has given it away
+    def __init__(self, url, task):
+        self.url = url
+        self.task = task
+        self.lost = False
+        self._stop = threading.Event()
+        self._thread = threading.Thread(target=self._run, daemon=True)
+
+    def _run(self):
+        interval = max(1.0, self.task["lease_seconds"] / 3.0)
+        while not self._stop.wait(interval):
+            try:
+                if not call(self.url, "/renew", {"id": self.task["id"], "token": self.task["token"]})["ok"]:
+                    self.lost = True
+                    return
+            except (OSError, ValueError):
+                # Keep trying; the lease only lapses if the coordinator stays unreachable
+                continue
+
+    def __enter__(self):
+        self._thread.start()
+        return self
+
+    def __exit__(self, *exc):
+        self._stop.set()
+        self._thread.join()
+        return False
+
+
+def wait_for_task(url, worker, poll_interval=1.0, retries=5):
+    # The next task for this worker, or None when the queue is finished or
+    # the coordinator has gone away. While other workers hold the remaining
+    # leases there is nothing to do yet, but one of them may still expire.
+    failures = 0
+    while True:
+        try:
+            response = call(url, "/lease", {"worker": worker})
+            failures = 0
+        except (OSError, ValueError) as e:
+            failures += 1
+            if failures > retries:
+                print(f"Coordinator at {url} unreachable ({e}), stopping.")
+                return None
+            time.sleep(poll_interval * failures)
+            continue
+        if response["task"] is not None:
+            return response["task"]
+        if response["done"]:
+            return None
+        time.sleep(poll_interval)
@@ -1,16 +1,42 @@
 #include <linux/module.h>     // Required for all kernel modules
 #include <linux/kernel.h>     // KERN_INFO, printk
+#include <linux/printk.h>     // pr_debug, printk_ratelimited
 #include <linux/fs.h>         // File operations, register_chrdev
 #include <linux/uaccess.h>    // copy_to_user, copy_from_user
 #include <linux/slab.h>       // kmalloc, kfree
 #include <linux/cdev.h>       // cdev_init, cdev_add
 #include <linux/device.h>     // class_create, device_create
 #include <linux/mutex.h>      // Mutex for synchronization
+#include <linux/log2.h>       // is_power_of_2
+#include <linux/bitops.h>     // test_and_set_bit, clear_bit
+#include <linux/moduleparam.h> // module_param
+#include <linux/mm.h>         // vm_area_struct
+#include <linux/gfp.h>        // alloc_pages_node, __free_pages
+#include <linux/topology.h>   // cpu_to_node, numa_node_id
+#include <linux/cpumask.h>    // cpumask_local_spread
+#include <linux/percpu.h>     // DEFINE_PER_CPU, this_cpu_add
+#include <linux/sysfs.h>      // sysfs_emit
+#include <linux/seqlock.h>    // seqcount_mutex_t
+#include <linux/uio.h>        // iov_iter, copy_to_iter, copy_from_iter
+#include <linux/wait.h>       // wait_queue_head_t, wait_event_interruptible
+#include <linux/poll.h>       // poll_wait, EPOLLIN, EPOLLOUT
+
+#include "good_driver.h"      // Ring layout shared with user space through mmap
 
 // --- Defines ---
 #define DEVICE_NAME "good_driver"
 #define CLASS_NAME  "good_class"
 #define BUFFER_SIZE 4096 // A reasonable buffer size for a simple device
+#define RING_SIZE   GOOD_RING_SIZE // Ring mode reuses the buffer; must be a power of two
+#define READ_MOSTLY_RETRIES 4 // Lockless read attempts before falling back to the mutex
+#define MAX_DEVICES 64 // Upper bound for nr_devices
+
+// Per-operation tracing on the I/O paths. Built on pr_debug: compiled out
+// unless DEBUG or CONFIG_DYNAMIC_DEBUG is set, and with dynamic debug off
+// until enabled at runtime, e.g.
+//   echo 'module good_driver +p' > /sys/kernel/debug/dynamic_debug/control
+// Error paths always log, but ratelimited, since user space can trigger them in a loop.
+#define good_trace(fmt, ...) pr_debug("%s: " fmt, DEVICE_NAME, ##__VA_ARGS__)
 
 // --- Module Information ---
 MODULE_LICENSE("GPL");
@@ -18,19 +44,162 @@ MODULE_AUTHOR("Your Name/Organization");
 MODULE_DESCRIPTION("A well-written Linux kernel character device driver.");
 MODULE_VERSION("1.0");
 
+// --- Module Parameters ---
+static bool ring_mode = false;
+module_param(ring_mode, bool, 0444);
+MODULE_PARM_DESC(ring_mode, "Expose the buffer as a lock-free single-reader/single-writer stream (default: off)");
+
+static bool read_mostly = false;
+module_param(read_mostly, bool, 0444);
+MODULE_PARM_DESC(read_mostly, "Let readers run concurrently without taking the buffer mutex (default: off)");
+
+static bool blocking_reads = false;
+module_param(blocking_reads, bool, 0444);
+MODULE_PARM_DESC(blocking_reads, "Make reads at the end of the data wait for a writer instead of returning 0; ring mode always waits (default: off)");
+
+static unsigned int nr_devices = 1;
+module_param(nr_devices, uint, 0444);
+MODULE_PARM_DESC(nr_devices, "Number of independent devices (queues), each with its own buffer and lock (default: 1)");
+
+static bool private_buffers = false;
+module_param(private_buffers, bool, 0444);
+MODULE_PARM_DESC(private_buffers, "Give every open file a buffer of its own instead of the device's (default: off)");
+
 // --- Global Variables (Protected) ---
-static dev_t major_minor_dev_num; // Stores major and minor numbers
+static dev_t major_minor_dev_num; // Stores major and first minor number
 static struct class* good_driver_class = NULL; // Device class
-static struct cdev good_driver_cdev; // Character device structure
 
-// Device-specific data structure
+// Ring (kfifo-style) view of the device buffer used in ring_mode.
+// head and tail are free-running byte counts in the shared header page (see
+// good_driver.h); only the writer moves head and only the reader moves tail,
+// so neither needs a lock.
+struct good_ring {
+    struct good_ring_header *hdr; // Indices, also mapped into user space
+    char *data;                   // RING_SIZE bytes (the device buffer)
+};
+
+// Per-CPU I/O counters, see stats_show()
+struct good_stats {
+    u64 reads;
+    u64 writes;
+    u64 bytes_read;
+    u64 bytes_written;
+    u64 errors;
+};
+
+// Device-specific data structure, one per minor. Allocated on the NUMA node
+// of the CPU the device is assigned to, so a client running there touches
+// only local memory. With private_buffers, each open file gets its own
+// instance with just the buffer fields set up (see good_dev_open()).
 struct good_driver_data {
+    struct cdev cdev;          // Character device for this minor
+    struct device *device;     // Its /dev and sysfs node
+    unsigned int index;        // Minor offset from major_minor_dev_num
+    int node;                  // NUMA node the memory below comes from
+    struct page *pages;        // Node-local pages: ring header, then buffer
+    void *area;                // page_address(pages)
     char *buffer;              // Device buffer
     size_t current_len;        // Current data length in buffer
     struct mutex buffer_mutex; // Mutex for protecting buffer access
+    seqcount_mutex_t buffer_seq; // Bumped by writers around buffer updates (read_mostly only)
+    char *staging;             // Writers' copy_from_user target (read_mostly only)
+    struct good_ring ring;     // Stream view of buffer (ring_mode only)
+    struct file *ring_reader;  // File that owns tail, claimed by its first read (ring_mode only)
+    struct file *ring_writer;  // File that owns head, claimed by its first write (ring_mode only)
+    wait_queue_head_t read_wait;  // Readers and pollers waiting for data
+    wait_queue_head_t write_wait; // Ring writers and pollers waiting for space (ring_mode only)
+    struct good_stats __percpu *stats; // The device's counters, shared by private opens
 };
 
-static struct good_driver_data *g_driver_data = NULL; // Pointer to driver's global data
+static struct good_driver_data *good_devs[MAX_DEVICES]; // The nr_devices instances
+
+// --- Statistics ---
+
+// Each device has per-CPU counters, so the I/O paths never share (or lock)
+// a cache line for bookkeeping; the copies are only summed when the stats
+// file is read. Totals read while I/O is in flight are approximate.
+#define good_stat_add(data, field, n) this_cpu_add((data)->stats->field, (n))
+
+/**
+ * @brief Shows a device's summed per-CPU counters in /sys/class/good_class/<device>/stats.
+ * @param dev The device the attribute belongs to.
+ * @param attr The attribute being read.
+ * @param buf Output buffer of PAGE_SIZE bytes.
+ * @return Number of bytes written to buf.
+ */
+static ssize_t stats_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    struct good_driver_data *data = dev_get_drvdata(dev);
+    struct good_stats total = { 0 };
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        const struct good_stats *stats = per_cpu_ptr(data->stats, cpu);
+
+        total.reads += READ_ONCE(stats->reads);
+        total.writes += READ_ONCE(stats->writes);
+        total.bytes_read += READ_ONCE(stats->bytes_read);
+        total.bytes_written += READ_ONCE(stats->bytes_written);
+        total.errors += READ_ONCE(stats->errors);
+    }
+
+    return sysfs_emit(buf, "reads %llu\nwrites %llu\nbytes_read %llu\nbytes_written %llu\nerrors %llu\n",
+                      total.reads, total.writes, total.bytes_read, total.bytes_written, total.errors);
+}
+static DEVICE_ATTR_RO(stats);
+
+static struct attribute *good_attrs[] = {
+    &dev_attr_stats.attr,
+    NULL,
+};
+ATTRIBUTE_GROUPS(good);
+
+// --- Wakeups ---
+
+/**
+ * @brief Wakes sleepers and pollers on wq, skipping the wait-queue lock when there are none.
+ * @param wq The wait queue to wake.
+ * @param events Poll events that became ready.
+ *
+ * The full barrier in wq_has_sleeper() orders the caller's update of the
+ * buffer length or ring index before the check; it pairs with the
+ * smp_mb() after poll_wait() and the one in prepare_to_wait().
+ */
+static inline void good_wake(wait_queue_head_t *wq, __poll_t events) {
+    if (wq_has_sleeper(wq))
+        wake_up_interruptible_poll(wq, events);
+}
+
+/**
+ * @brief Tells whether an I/O request must not sleep.
+ * @param iocb I/O control block.
+ * @return True for O_NONBLOCK files and IOCB_NOWAIT (io_uring, RWF_NOWAIT) requests.
+ */
+static inline bool good_nonblock(const struct kiocb *iocb) {
+    return (iocb->ki_filp->f_flags & O_NONBLOCK) || (iocb->ki_flags & IOCB_NOWAIT);
+}
+
+/**
+ * @brief With blocking_reads, waits until a writer has extended the data past the file position.
+ * @param data The device (or private buffer) being read.
+ * @param iocb I/O control block; ki_pos is the file offset.
+ * @return 0 when there is data to read or blocking_reads is off, -EAGAIN for non-blocking requests, or -ERESTARTSYS.
+ *
+ * Without blocking_reads the default and read_mostly modes keep regular-file
+ * semantics: a read at the end of the data returns 0, so cat and cp finish.
+ * An offset at or past BUFFER_SIZE can never get data and reads as end-of-file
+ * either way.
+ */
+static int good_wait_for_data(struct good_driver_data *data, struct kiocb *iocb) {
+    if (!blocking_reads || iocb->ki_pos >= BUFFER_SIZE)
+        return 0;
+    while (iocb->ki_pos >= READ_ONCE(data->current_len)) {
+        if (good_nonblock(iocb))
+            return -EAGAIN;
+        if (wait_event_interruptible(data->read_wait, iocb->ki_pos < READ_ONCE(data->current_len)))
+            return -ERESTARTSYS;
+    }
+    return 0;
+}
 
 // --- File Operations ---
 
@@ -41,16 +210,38 @@ static struct good_driver_data *g_driver_data = NULL; // Pointer to driver's glo
  * @return 0 on success, or a negative error code on failure.
  */
 static int good_dev_open(struct inode *inode, struct file *file) {
+    struct good_driver_data *dev = container_of(inode->i_cdev, struct good_driver_data, cdev);
+    struct good_driver_data *data;
+    int node;
+
     // Associate our private data with the file pointer for later use.
-    // This is good practice for managing per-device or per-open data.
-    file->private_data = g_driver_data;
+    // Opens of the same minor share its buffer and rely on buffer_mutex for
+    // data integrity; different minors never contend with each other.
+    if (!private_buffers) {
+        file->private_data = dev;
+        good_trace("Device %u opened.\n", dev->index);
+        return 0;
+    }
 
-    // We don't need a counter for open instances if we only allow one,
-    // or if the mutex handles concurrent access effectively for the buffer.
-    // For simplicity, this driver implicitly allows multiple opens but
-    // relies on the buffer_mutex for data integrity.
+    // Private buffer: nothing is shared with other opens but the device's
+    // counters, and the memory is local to the opening CPU
+    node = numa_node_id();
+    data = kzalloc_node(sizeof(*data), GFP_KERNEL, node);
+    if (!data)
+        return -ENOMEM;
+    data->buffer = kzalloc_node(BUFFER_SIZE, GFP_KERNEL, node);
+    if (!data->buffer) {
+        kfree(data);
+        return -ENOMEM;
+    }
+    data->index = dev->index;
+    data->node = node;
+    data->stats = dev->stats;
+    mutex_init(&data->buffer_mutex);
+    init_waitqueue_head(&data->read_wait);
 
-    printk(KERN_INFO "%s: Device opened.\n", DEVICE_NAME);
+    file->private_data = data;
+    good_trace("Device %u opened with a private buffer on node %d.\n", dev->index, node);
     return 0;
 }
 
@@ -63,102 +254,125 @@ static int good_dev_open(struct inode *inode, struct file *file) {
  * @return 0 on success.
  */
 static int good_dev_release(struct inode *inode, struct file *file) {
-    printk(KERN_INFO "%s: Device closed.\n", DEVICE_NAME);
+    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+
+    if (private_buffers) {
+        kfree(data->buffer);
+        kfree(data);
+    }
+    good_trace("Device closed.\n");
     return 0;
 }
 
 // -----------------------------------------------------------------------------
 
 /**
- * @brief Handles device read requests.
- * @param file Pointer to the file structure.
- * @param user_buffer Pointer to the user-space buffer.
- * @param len Maximum number of bytes to read.
- * @param offset Pointer to the current file offset.
+ * @brief Handles device read requests, including readv() and io_uring.
+ * @param iocb I/O control block; ki_pos is the file offset.
+ * @param to Destination segments in user space.
  * @return Number of bytes read on success, or a negative error code on failure.
  */
-static ssize_t good_dev_read(struct file *file, char __user *user_buffer, size_t len, loff_t *offset) {
-    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+static ssize_t good_dev_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct good_driver_data *data = (struct good_driver_data *)iocb->ki_filp->private_data;
     ssize_t bytes_to_read;
+    size_t copied;
     int ret;
 
-    // Acquire mutex to protect buffer during read
-    if (mutex_lock_interruptible(&data->buffer_mutex)) {
-        printk(KERN_WARNING "%s: Read: Mutex lock interrupted.\n", DEVICE_NAME);
+    ret = good_wait_for_data(data, iocb);
+    if (ret)
+        return ret;
+
+    // Acquire mutex to protect buffer during read. A blocking_reads caller
+    // that must not sleep does not wait for a writer to release it either.
+    if (blocking_reads && good_nonblock(iocb)) {
+        if (!mutex_trylock(&data->buffer_mutex))
+            return -EAGAIN;
+    } else if (mutex_lock_interruptible(&data->buffer_mutex)) {
+        printk_ratelimited(KERN_WARNING "%s: Read: Mutex lock interrupted.\n", DEVICE_NAME);
         return -ERESTARTSYS; // Signal that syscall should be restarted
     }
 
     // Determine how many bytes to copy
     // Ensure we don't read past the end of the data in our buffer
-    bytes_to_read = min((size_t)(data->current_len - *offset), len);
+    bytes_to_read = 0;
+    if (iocb->ki_pos < data->current_len)
+        bytes_to_read = min((size_t)(data->current_len - iocb->ki_pos), iov_iter_count(to));
 
     if (bytes_to_read <= 0) {
         mutex_unlock(&data->buffer_mutex);
         return 0; // No more data to read or offset is past end
     }
 
-    // Copy data from kernel space to user space
-    ret = copy_to_user(user_buffer, data->buffer + *offset, bytes_to_read);
-    if (ret != 0) {
-        // If ret is non-zero, it indicates the number of bytes that could NOT be copied.
-        printk(KERN_ERR "%s: Read: Failed to copy %d bytes to user space.\n", DEVICE_NAME, ret);
+    // One copy fills every segment of the request, under one lock hold
+    copied = copy_to_iter(data->buffer + iocb->ki_pos, bytes_to_read, to);
+    if (copied == 0) {
+        printk_ratelimited(KERN_ERR "%s: Read: Failed to copy to user space.\n", DEVICE_NAME);
+        good_stat_add(data, errors, 1);
         mutex_unlock(&data->buffer_mutex);
         return -EFAULT; // Bad address
     }
 
-    *offset += bytes_to_read; // Update the file offset
+    // A fault part-way through the segments is a short read
+    iocb->ki_pos += copied; // Update the file offset
     mutex_unlock(&data->buffer_mutex); // Release mutex
 
-    printk(KERN_INFO "%s: Read %zd bytes from device. Offset now %lld.\n", DEVICE_NAME, bytes_to_read, *offset);
-    return bytes_to_read;
+    good_stat_add(data, reads, 1);
+    good_stat_add(data, bytes_read, copied);
+    good_trace("Read %zu bytes from device. Offset now %lld.\n", copied, iocb->ki_pos);
+    return copied;
 }
 
 // -----------------------------------------------------------------------------
 
 /**
- * @brief Handles device write requests.
- * @param file Pointer to the file structure.
- * @param user_buffer Pointer to the user-space buffer.
- * @param len Number of bytes to write.
- * @param offset Pointer to the current file offset.
+ * @brief Handles device write requests, including writev() and io_uring.
+ * @param iocb I/O control block; ki_pos is the file offset.
+ * @param from Source segments in user space.
  * @return Number of bytes written on success, or a negative error code on failure.
  */
-static ssize_t good_dev_write(struct file *file, const char __user *user_buffer, size_t len, loff_t *offset) {
-    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+static ssize_t good_dev_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct good_driver_data *data = (struct good_driver_data *)iocb->ki_filp->private_data;
     ssize_t bytes_to_write;
-    int ret;
+    size_t copied;
 
     // Acquire mutex to protect buffer during write
     if (mutex_lock_interruptible(&data->buffer_mutex)) {
-        printk(KERN_WARNING "%s: Write: Mutex lock interrupted.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Write: Mutex lock interrupted.\n", DEVICE_NAME);
         return -ERESTARTSYS; // Signal that syscall should be restarted
     }
 
     // Determine how many bytes to copy
-    // Ensure we don't write past the end of our buffer
-    bytes_to_write = min((size_t)(BUFFER_SIZE - *offset), len);
+    // Ensure we don't write past the end of our buffer, even from a pwrite()
+    // offset beyond it
+    bytes_to_write = 0;
+    if (iocb->ki_pos < BUFFER_SIZE)
+        bytes_to_write = min((size_t)(BUFFER_SIZE - iocb->ki_pos), iov_iter_count(from));
 
     if (bytes_to_write <= 0) {
         mutex_unlock(&data->buffer_mutex);
-        printk(KERN_WARNING "%s: Write: Buffer full or offset too large. No bytes written.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Write: Buffer full or offset too large. No bytes written.\n", DEVICE_NAME);
         return -ENOSPC; // No space left on device
     }
 
-    // Copy data from user space to kernel space
-    ret = copy_from_user(data->buffer + *offset, user_buffer, bytes_to_write);
-    if (ret != 0) {
-        printk(KERN_ERR "%s: Write: Failed to copy %d bytes from user space.\n", DEVICE_NAME, ret);
+    // Gathers every segment of the request, under one lock hold
+    copied = copy_from_iter(data->buffer + iocb->ki_pos, bytes_to_write, from);
+    if (copied == 0) {
+        printk_ratelimited(KERN_ERR "%s: Write: Failed to copy from user space.\n", DEVICE_NAME);
+        good_stat_add(data, errors, 1);
         mutex_unlock(&data->buffer_mutex);
         return -EFAULT; // Bad address
     }
 
-    *offset += bytes_to_write; // Update the file offset
-    data->current_len = *offset; // Update the current length of data in the buffer
+    iocb->ki_pos += copied; // Update the file offset
+    data->current_len = iocb->ki_pos; // Update the current length of data in the buffer
 
     mutex_unlock(&data->buffer_mutex); // Release mutex
+    good_wake(&data->read_wait, EPOLLIN | EPOLLRDNORM);
 
-    printk(KERN_INFO "%s: Written %zd bytes to device. Offset now %lld.\n", DEVICE_NAME, bytes_to_write, *offset);
-    return bytes_to_write;
+    good_stat_add(data, writes, 1);
+    good_stat_add(data, bytes_written, copied);
+    good_trace("Written %zu bytes to device. Offset now %lld.\n", copied, iocb->ki_pos);
+    return copied;
 }
 
 // -----------------------------------------------------------------------------
@@ -176,7 +390,7 @@ static loff_t good_dev_llseek(struct file *file, loff_t offset, int whence) {
 
     // Acquire mutex to protect current_len during seek operation
     if (mutex_lock_interruptible(&data->buffer_mutex)) {
-        printk(KERN_WARNING "%s: Lseek: Mutex lock interrupted.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Lseek: Mutex lock interrupted.\n", DEVICE_NAME);
         return -ERESTARTSYS;
     }
 
@@ -198,29 +412,586 @@ static loff_t good_dev_llseek(struct file *file, loff_t offset, int whence) {
     // Validate the new offset
     if (new_offset < 0 || new_offset > BUFFER_SIZE) {
         mutex_unlock(&data->buffer_mutex);
-        printk(KERN_WARNING "%s: Lseek: Invalid offset %lld.\n", DEVICE_NAME, new_offset);
+        printk_ratelimited(KERN_WARNING "%s: Lseek: Invalid offset %lld.\n", DEVICE_NAME, new_offset);
         return -EINVAL;
     }
 
     *(&file->f_pos) = new_offset; // Update file position
     mutex_unlock(&data->buffer_mutex);
 
-    printk(KERN_INFO "%s: Seeked to offset %lld.\n", DEVICE_NAME, new_offset);
+    good_trace("Seeked to offset %lld.\n", new_offset);
     return new_offset;
 }
 
 // -----------------------------------------------------------------------------
 
-// File operations structure
+/**
+ * @brief Reports whether there is data past the file position, for poll/select/epoll.
+ * @param file Pointer to the file structure.
+ * @param wait Poll table the caller sleeps on.
+ * @return EPOLLIN when data lies past the file position, EPOLLOUT while the buffer has room there.
+ *
+ * Reads at the end of the data still return 0 unless blocking_reads is set:
+ * the device is a seekable file, and blocking there would hang cat and cp.
+ * Clients that want to wait for a writer to extend the data poll for EPOLLIN
+ * or load the module with blocking_reads=1.
+ */
+static __poll_t good_dev_poll(struct file *file, poll_table *wait) {
+    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+    __poll_t mask = 0;
+
+    poll_wait(file, &data->read_wait, wait);
+    smp_mb(); // Pairs with the barrier in good_wake()
+
+    if (file->f_pos < READ_ONCE(data->current_len))
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if (file->f_pos < BUFFER_SIZE)
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    return mask;
+}
+
+// -----------------------------------------------------------------------------
+
+// File operations structure. Plain read()/write() reach the _iter handlers
+// through the VFS too. The splice helpers are the pre-6.5 generic ones that
+// drive read_iter/write_iter directly, so splice() and sendfile() move data
+// without a bounce through user space.
 static const struct file_operations good_fops = {
     .owner = THIS_MODULE,
     .open = good_dev_open,
     .release = good_dev_release,
-    .read = good_dev_read,
-    .write = good_dev_write,
+    .read_iter = good_dev_read_iter,
+    .write_iter = good_dev_write_iter,
+    .splice_read = generic_file_splice_read,
+    .splice_write = iter_file_splice_write,
+    .poll = good_dev_poll,
     .llseek = good_dev_llseek, // Implement seek for better device behavior
 };
 
+// --- Read-Mostly Mode File Operations ---
+
+// With read_mostly=1, writers still serialize on buffer_mutex but readers
+// never take it: they copy under buffer_seq and retry if a writer got in.
+// Copying to user space may sleep, which rules out an rcu_read_lock()
+// section, and reference-counting buffer versions would put a shared atomic
+// back on every read. Writers copy from user space into `staging` first, so the
+// section readers can collide with is a memcpy() and never faults.
+
+/**
+ * @brief Reads from the buffer without taking buffer_mutex.
+ * @param iocb I/O control block; ki_pos is the file offset.
+ * @param to Destination segments in user space.
+ * @return Number of bytes read on success, or a negative error code on failure.
+ */
+static ssize_t good_rm_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct good_driver_data *data = (struct good_driver_data *)iocb->ki_filp->private_data;
+    size_t bytes_to_read, copied;
+    unsigned int seq;
+    int attempt, ret;
+
+    ret = good_wait_for_data(data, iocb);
+    if (ret)
+        return ret;
+
+    for (attempt = 0; attempt < READ_MOSTLY_RETRIES; attempt++) {
+        seq = read_seqcount_begin(&data->buffer_seq);
+
+        bytes_to_read = 0;
+        if (iocb->ki_pos < data->current_len)
+            bytes_to_read = min((size_t)(data->current_len - iocb->ki_pos), iov_iter_count(to));
+
+        copied = 0;
+        if (bytes_to_read)
+            copied = copy_to_iter(data->buffer + iocb->ki_pos, bytes_to_read, to);
+
+        if (!read_seqcount_retry(&data->buffer_seq, seq)) {
+            if (bytes_to_read && copied == 0) {
+                printk_ratelimited(KERN_ERR "%s: Read: Failed to copy to user space.\n", DEVICE_NAME);
+                good_stat_add(data, errors, 1);
+                return -EFAULT;
+            }
+            iocb->ki_pos += copied;
+            if (copied) {
+                good_stat_add(data, reads, 1);
+                good_stat_add(data, bytes_read, copied);
+            }
+            return copied;
+        }
+
+        // A copy torn by a concurrent write is overwritten by the next attempt
+        iov_iter_revert(to, copied);
+    }
+
+    // Writers keep winning: wait for them like the default mode does
+    return good_dev_read_iter(iocb, to);
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Writes to the buffer, publishing the update to lockless readers.
+ * @param iocb I/O control block; ki_pos is the file offset.
+ * @param from Source segments in user space.
+ * @return Number of bytes written on success, or a negative error code on failure.
+ */
+static ssize_t good_rm_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct good_driver_data *data = (struct good_driver_data *)iocb->ki_filp->private_data;
+    ssize_t bytes_to_write;
+    size_t copied;
+
+    if (mutex_lock_interruptible(&data->buffer_mutex)) {
+        printk_ratelimited(KERN_WARNING "%s: Write: Mutex lock interrupted.\n", DEVICE_NAME);
+        return -ERESTARTSYS;
+    }
+
+    bytes_to_write = 0;
+    if (iocb->ki_pos < BUFFER_SIZE)
+        bytes_to_write = min((size_t)(BUFFER_SIZE - iocb->ki_pos), iov_iter_count(from));
+    if (bytes_to_write <= 0) {
+        mutex_unlock(&data->buffer_mutex);
+        printk_ratelimited(KERN_WARNING "%s: Write: Buffer full or offset too large. No bytes written.\n", DEVICE_NAME);
+        return -ENOSPC;
+    }
+
+    copied = copy_from_iter(data->staging, bytes_to_write, from);
+    if (copied == 0) {
+        printk_ratelimited(KERN_ERR "%s: Write: Failed to copy from user space.\n", DEVICE_NAME);
+        good_stat_add(data, errors, 1);
+        mutex_unlock(&data->buffer_mutex);
+        return -EFAULT;
+    }
+
+    // Readers that overlap this section see the count change and retry
+    write_seqcount_begin(&data->buffer_seq);
+    memcpy(data->buffer + iocb->ki_pos, data->staging, copied);
+    data->current_len = iocb->ki_pos + copied; // Same truncating semantics as good_dev_write_iter
+    write_seqcount_end(&data->buffer_seq);
+
+    iocb->ki_pos += copied;
+    mutex_unlock(&data->buffer_mutex);
+    good_wake(&data->read_wait, EPOLLIN | EPOLLRDNORM);
+
+    good_stat_add(data, writes, 1);
+    good_stat_add(data, bytes_written, copied);
+    good_trace("Written %zu bytes to device. Offset now %lld.\n", copied, iocb->ki_pos);
+    return copied;
+}
+
+// -----------------------------------------------------------------------------
+
+// File operations used when loaded with read_mostly=1. Seeking is unchanged:
+// good_dev_llseek takes buffer_mutex, which excludes writers but not readers.
+static const struct file_operations good_rm_fops = {
+    .owner = THIS_MODULE,
+    .open = good_dev_open,
+    .release = good_dev_release,
+    .read_iter = good_rm_read_iter,
+    .write_iter = good_rm_write_iter,
+    .splice_read = generic_file_splice_read,
+    .splice_write = iter_file_splice_write,
+    .poll = good_dev_poll,
+    .llseek = good_dev_llseek,
+};
+
+// --- Ring Mode File Operations ---
+
+/**
+ * @brief Opens the device as a stream. The reader and writer sides are claimed later, see good_ring_claim().
+ * @param inode Pointer to the inode structure.
+ * @param file Pointer to the file structure.
+ * @return 0 on success.
+ */
+static int good_ring_open(struct inode *inode, struct file *file) {
+    struct good_driver_data *data = container_of(inode->i_cdev, struct good_driver_data, cdev);
+
+    file->private_data = data;
+    stream_open(inode, file); // No file position: reads and writes consume and append
+    file->f_mode |= FMODE_NOWAIT; // IOCB_NOWAIT is honoured, so io_uring need not punt to a worker
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Releases whichever ring sides this file claimed.
+ * @param inode Pointer to the inode structure.
+ * @param file Pointer to the file structure.
+ * @return 0 on success.
+ */
+static int good_ring_release(struct inode *inode, struct file *file) {
+    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+
+    cmpxchg(&data->ring_reader, file, NULL);
+    cmpxchg(&data->ring_writer, file, NULL);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Makes file the owner of one side of the ring, unless another file already owns it.
+ * @param owner &data->ring_reader or &data->ring_writer.
+ * @param file The file doing the read or write.
+ * @return 0 if file owns that side, -EBUSY if another open file does.
+ */
+static inline int good_ring_claim(struct file **owner, struct file *file) {
+    // The ring is only lock-free for one producer and one consumer, so a
+    // second reader or writer is refused rather than serialized. The claim
+    // is made on first use rather than at open: mapping the ring needs an
+    // O_RDWR open on both sides, and that must not take both slots.
+    if (READ_ONCE(*owner) == file)
+        return 0;
+    return cmpxchg(owner, NULL, file) == NULL ? 0 : -EBUSY;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Tells whether the ring has data for the reader (or corrupt indices to report).
+ * @param ring The ring.
+ * @return True when a read would not have to wait.
+ */
+static inline bool good_ring_readable(struct good_ring *ring) {
+    return smp_load_acquire(&ring->hdr->head) != READ_ONCE(ring->hdr->tail);
+}
+
+/**
+ * @brief Tells whether the ring has space for the writer (or corrupt indices to report).
+ * @param ring The ring.
+ * @return True when a write would not have to wait.
+ */
+static inline bool good_ring_writable(struct good_ring *ring) {
+    return READ_ONCE(ring->hdr->head) - smp_load_acquire(&ring->hdr->tail) != RING_SIZE;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Consumes bytes from the ring without taking buffer_mutex, waiting for data if it is empty.
+ * @param iocb I/O control block; ki_pos is unused, the device is a stream in ring mode.
+ * @param to Destination segments in user space.
+ * @return Number of bytes read, -EBUSY if another file is the reader, -EAGAIN if empty and non-blocking, -ERESTARTSYS, -EIO on corrupt indices, or -EFAULT.
+ */
+static ssize_t good_ring_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct good_driver_data *data = (struct good_driver_data *)iocb->ki_filp->private_data;
+    struct good_ring *ring = &data->ring;
+    unsigned int head, tail, start;
+    size_t bytes_to_read, first, copied;
+
+    if (good_ring_claim(&data->ring_reader, iocb->ki_filp))
+        return -EBUSY;
+
+    // A zero-length read is a doorbell for a consumer working through mmap:
+    // it wakes a writer waiting for the space that consumer released
+    if (iov_iter_count(to) == 0) {
+        good_wake(&data->write_wait, EPOLLOUT | EPOLLWRNORM);
+        return 0;
+    }
+
+    // The ring never reports end-of-file: an empty ring means "not yet"
+    while (!good_ring_readable(ring)) {
+        if (good_nonblock(iocb))
+            return -EAGAIN;
+        if (wait_event_interruptible(data->read_wait, good_ring_readable(ring)))
+            return -ERESTARTSYS;
+    }
+
+    // Acquire pairs with the writer's release of head: the bytes it published
+    // are visible before we copy them. tail is ours alone.
+    head = smp_load_acquire(&ring->hdr->head);
+    tail = READ_ONCE(ring->hdr->tail);
+
+    // The indices are writable through mmap, so never trust them blindly
+    if (head - tail > RING_SIZE)
+        return -EIO;
+
+    bytes_to_read = min_t(size_t, head - tail, iov_iter_count(to));
+
+    // The data may wrap past the end of the buffer: copy it in two pieces
+    start = tail & (RING_SIZE - 1);
+    first = min_t(size_t, bytes_to_read, RING_SIZE - start);
+    copied = copy_to_iter(ring->data + start, first, to);
+    if (copied == first)
+        copied += copy_to_iter(ring->data, bytes_to_read - first, to);
+    if (copied == 0) {
+        printk_ratelimited(KERN_ERR "%s: Ring read: Failed to copy to user space.\n", DEVICE_NAME);
+        good_stat_add(data, errors, 1);
+        return -EFAULT;
+    }
+
+    // Release: our reads of the data complete before the writer may reuse the
+    // space. Only what reached user space is consumed.
+    smp_store_release(&ring->hdr->tail, tail + copied);
+    good_wake(&data->write_wait, EPOLLOUT | EPOLLWRNORM);
+    good_stat_add(data, reads, 1);
+    good_stat_add(data, bytes_read, copied);
+    return copied;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Appends bytes to the ring without taking buffer_mutex, waiting for space if it is full.
+ * @param iocb I/O control block; ki_pos is unused, the device is a stream in ring mode.
+ * @param from Source segments in user space.
+ * @return Number of bytes written, -EBUSY if another file is the writer, -EAGAIN if full and non-blocking, -ERESTARTSYS, -EIO on corrupt indices, or -EFAULT.
+ */
+static ssize_t good_ring_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct good_driver_data *data = (struct good_driver_data *)iocb->ki_filp->private_data;
+    struct good_ring *ring = &data->ring;
+    unsigned int head, tail, start;
+    size_t bytes_to_write, first, copied;
+
+    if (good_ring_claim(&data->ring_writer, iocb->ki_filp))
+        return -EBUSY;
+
+    // A zero-length write is a doorbell for a producer working through mmap:
+    // it wakes a reader waiting for the data that producer published
+    if (iov_iter_count(from) == 0) {
+        good_wake(&data->read_wait, EPOLLIN | EPOLLRDNORM);
+        return 0;
+    }
+
+    while (!good_ring_writable(ring)) {
+        if (good_nonblock(iocb))
+            return -EAGAIN; // Full until the reader drains it
+        if (wait_event_interruptible(data->write_wait, good_ring_writable(ring)))
+            return -ERESTARTSYS;
+    }
+
+    // Acquire pairs with the reader's release of tail: space it freed is no
+    // longer being read. head is ours alone.
+    tail = smp_load_acquire(&ring->hdr->tail);
+    head = READ_ONCE(ring->hdr->head);
+
+    if (head - tail > RING_SIZE)
+        return -EIO;
+
+    bytes_to_write = min_t(size_t, RING_SIZE - (head - tail), iov_iter_count(from));
+
+    start = head & (RING_SIZE - 1);
+    first = min_t(size_t, bytes_to_write, RING_SIZE - start);
+    copied = copy_from_iter(ring->data + start, first, from);
+    if (copied == first)
+        copied += copy_from_iter(ring->data, bytes_to_write - first, from);
+    if (copied == 0) {
+        printk_ratelimited(KERN_ERR "%s: Ring write: Failed to copy from user space.\n", DEVICE_NAME);
+        good_stat_add(data, errors, 1);
+        return -EFAULT;
+    }
+
+    // Release: the data is in place before the reader can see the new head
+    smp_store_release(&ring->hdr->head, head + copied);
+    good_wake(&data->read_wait, EPOLLIN | EPOLLRDNORM);
+    good_stat_add(data, writes, 1);
+    good_stat_add(data, bytes_written, copied);
+    return copied;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Reports ring readiness for poll/select/epoll.
+ * @param file Pointer to the file structure.
+ * @param wait Poll table the caller sleeps on.
+ * @return EPOLLIN/EPOLLOUT for the sides this file opened and could claim, or EPOLLERR on corrupt indices.
+ */
+static __poll_t good_ring_poll(struct file *file, poll_table *wait) {
+    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+    struct good_ring *ring = &data->ring;
+    struct file *reader, *writer;
+    unsigned int head, tail;
+    __poll_t mask = 0;
+
+    poll_wait(file, &data->read_wait, wait);
+    poll_wait(file, &data->write_wait, wait);
+    smp_mb(); // Pairs with the barrier in good_wake()
+
+    head = smp_load_acquire(&ring->hdr->head);
+    tail = smp_load_acquire(&ring->hdr->tail);
+    if (head - tail > RING_SIZE)
+        return EPOLLERR;
+
+    // A side another file owns is never ready for this one
+    reader = READ_ONCE(data->ring_reader);
+    writer = READ_ONCE(data->ring_writer);
+    if ((file->f_mode & FMODE_READ) && (!reader || reader == file) && head != tail)
+        mask |= EPOLLIN | EPOLLRDNORM;
+    if ((file->f_mode & FMODE_WRITE) && (!writer || writer == file) && head - tail < RING_SIZE)
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    return mask;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Maps the ring header and data into user space for zero-copy access.
+ * @param file Pointer to the file structure.
+ * @param vma The user mapping; must start at offset 0 and span at most GOOD_RING_MMAP_SIZE.
+ * @return 0 on success, or a negative error code on failure.
+ */
+static int good_ring_mmap(struct file *file, struct vm_area_struct *vma) {
+    struct good_driver_data *data = (struct good_driver_data *)file->private_data;
+
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_ALIGN(GOOD_RING_MMAP_SIZE))
+        return -EINVAL;
+
+    // The pages are one zeroed, physically contiguous block, so a single
+    // PFN mapping covers header and data. Both sides need it shared and
+    // writable to move their index, hence O_RDWR opens; mapping claims
+    // neither side of the ring (see good_ring_claim()).
+    return remap_pfn_range(vma, vma->vm_start, page_to_pfn(data->pages), vma->vm_end - vma->vm_start,
+                           vma->vm_page_prot);
+}
+
+// -----------------------------------------------------------------------------
+
+// File operations used when loaded with ring_mode=1. There is no .llseek:
+// stream_open() makes seeking fail with -ESPIPE.
+static const struct file_operations good_ring_fops = {
+    .owner = THIS_MODULE,
+    .open = good_ring_open,
+    .release = good_ring_release,
+    .read_iter = good_ring_read_iter,
+    .write_iter = good_ring_write_iter,
+    .splice_read = generic_file_splice_read,
+    .splice_write = iter_file_splice_write,
+    .poll = good_ring_poll,
+    .mmap = good_ring_mmap,
+};
+
+// --- Device Instances ---
+
+/**
+ * @brief Frees an instance's memory; the counterpart of good_alloc_instance().
+ * @param data The instance, or NULL.
+ */
+static void good_free_instance(struct good_driver_data *data) {
+    if (!data)
+        return;
+    if (data->pages)
+        __free_pages(data->pages, get_order(GOOD_RING_MMAP_SIZE));
+    kfree(data->staging); // NULL unless read_mostly
+    free_percpu(data->stats);
+    kfree(data);
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Allocates and initializes device instance index on the NUMA node of its CPU.
+ * @param index Minor offset of the device.
+ * @return The instance, or NULL if memory ran out.
+ *
+ * Instance i is assigned cpumask_local_spread(i), so consecutive devices
+ * land on different CPUs and, on NUMA machines, on different nodes, the way
+ * a multi-queue device spreads its queues.
+ */
+static struct good_driver_data *good_alloc_instance(unsigned int index) {
+    int node = cpu_to_node(cpumask_local_spread(index, NUMA_NO_NODE));
+    struct good_driver_data *data;
+
+    data = kzalloc_node(sizeof(*data), GFP_KERNEL, node);
+    if (!data)
+        return NULL;
+    data->index = index;
+    data->node = node;
+
+    // Page-backed so the ring can be mapped into user space
+    data->pages = alloc_pages_node(node, GFP_KERNEL | __GFP_ZERO, get_order(GOOD_RING_MMAP_SIZE));
+    data->stats = alloc_percpu(struct good_stats);
+    if (read_mostly)
+        data->staging = kmalloc_node(BUFFER_SIZE, GFP_KERNEL, node);
+    if (!data->pages || !data->stats || (read_mostly && !data->staging)) {
+        good_free_instance(data);
+        return NULL;
+    }
+
+    data->area = page_address(data->pages);
+    data->current_len = 0; // Buffer is initially empty
+    data->buffer = (char *)data->area + GOOD_RING_DATA_OFFSET;
+    data->ring.hdr = data->area; // Zeroed: head == tail == 0, the ring is empty
+    data->ring.hdr->size = GOOD_RING_SIZE;
+    data->ring.hdr->data_offset = GOOD_RING_DATA_OFFSET;
+    data->ring.data = data->buffer;
+
+    mutex_init(&data->buffer_mutex);
+    init_waitqueue_head(&data->read_wait);
+    init_waitqueue_head(&data->write_wait);
+    seqcount_mutex_init(&data->buffer_seq, &data->buffer_mutex);
+    return data;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Creates device index: its memory, character device and device node.
+ * @param index Minor offset of the device.
+ * @return 0 on success, or a negative error code on failure.
+ */
+static int good_create_device(unsigned int index) {
+    dev_t devt = MKDEV(MAJOR(major_minor_dev_num), MINOR(major_minor_dev_num) + index);
+    struct good_driver_data *data;
+    int ret;
+
+    // 1. Allocate and initialize the device data before it can be opened
+    data = good_alloc_instance(index);
+    if (!data) {
+        printk(KERN_ALERT "%s: Failed to allocate device %u.\n", DEVICE_NAME, index);
+        return -ENOMEM;
+    }
+
+    // 2. Initialize the character device structure and add it to the kernel
+    if (ring_mode)
+        cdev_init(&data->cdev, &good_ring_fops);
+    else if (read_mostly)
+        cdev_init(&data->cdev, &good_rm_fops);
+    else
+        cdev_init(&data->cdev, &good_fops);
+    data->cdev.owner = THIS_MODULE;
+
+    ret = cdev_add(&data->cdev, devt, 1);
+    if (ret < 0) {
+        printk(KERN_ALERT "%s: Failed to add character device %u: %d\n", DEVICE_NAME, index, ret);
+        good_free_instance(data);
+        return ret;
+    }
+
+    // 3. Create the device file in /dev/ (udev will pick this up)
+    //    The stats attribute is created with the device, before udev is notified.
+    //    A single device keeps the plain name; several are numbered.
+    data->device = device_create_with_groups(good_driver_class, NULL, devt, data, good_groups,
+                                             nr_devices > 1 ? DEVICE_NAME "%u" : DEVICE_NAME, index);
+    if (IS_ERR(data->device)) {
+        ret = PTR_ERR(data->device);
+        printk(KERN_ALERT "%s: Failed to create device %u: %d\n", DEVICE_NAME, index, ret);
+        cdev_del(&data->cdev);
+        good_free_instance(data);
+        return ret;
+    }
+
+    good_devs[index] = data;
+    printk(KERN_INFO "%s: Device %u created on NUMA node %d.\n", DEVICE_NAME, index, data->node);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+/**
+ * @brief Removes device index; the counterpart of good_create_device().
+ * @param index Minor offset of the device.
+ */
+static void good_destroy_device(unsigned int index) {
+    struct good_driver_data *data = good_devs[index];
+
+    if (!data)
+        return;
+    device_destroy(good_driver_class, data->cdev.dev);
+    cdev_del(&data->cdev);
+    good_free_instance(data);
+    good_devs[index] = NULL;
+}
+
 // --- Module Initialization ---
 
 /**
@@ -228,84 +999,67 @@ static const struct file_operations good_fops = {
  * @return 0 on success, or a negative error code on failure.
  */
 static int __init good_driver_init(void) {
+    unsigned int i;
     int ret;
-    struct device* good_device = NULL;
 
     printk(KERN_INFO "%s: Initializing Good Driver module.\n", DEVICE_NAME);
 
-    // 1. Allocate a major and minor number dynamically
-    ret = alloc_chrdev_region(&major_minor_dev_num, 0, 1, DEVICE_NAME);
+    // Ring indices are masked with RING_SIZE - 1
+    BUILD_BUG_ON(!is_power_of_2(RING_SIZE));
+    BUILD_BUG_ON(RING_SIZE != BUFFER_SIZE);
+    BUILD_BUG_ON(sizeof(struct good_ring_header) > GOOD_RING_DATA_OFFSET);
+
+    if (ring_mode && read_mostly) {
+        printk(KERN_ALERT "%s: ring_mode and read_mostly cannot be combined.\n", DEVICE_NAME);
+        return -EINVAL;
+    }
+    // Private buffers replace the shared one the other modes are built around
+    if (private_buffers && (ring_mode || read_mostly)) {
+        printk(KERN_ALERT "%s: private_buffers only applies to the default mode.\n", DEVICE_NAME);
+        return -EINVAL;
+    }
+    if (nr_devices < 1 || nr_devices > MAX_DEVICES) {
+        printk(KERN_ALERT "%s: nr_devices must be between 1 and %d.\n", DEVICE_NAME, MAX_DEVICES);
+        return -EINVAL;
+    }
+
+    // 1. Allocate a major and a range of minor numbers dynamically
+    ret = alloc_chrdev_region(&major_minor_dev_num, 0, nr_devices, DEVICE_NAME);
     if (ret < 0) {
         printk(KERN_ALERT "%s: Failed to allocate major/minor numbers: %d\n", DEVICE_NAME, ret);
         return ret;
     }
-    printk(KERN_INFO "%s: Allocated device numbers Major: %d, Minor: %d\n", DEVICE_NAME, MAJOR(major_minor_dev_num), MINOR(major_minor_dev_num));
+    printk(KERN_INFO "%s: Allocated device numbers Major: %d, Minors: %d-%d\n", DEVICE_NAME,
+           MAJOR(major_minor_dev_num), MINOR(major_minor_dev_num), MINOR(major_minor_dev_num) + nr_devices - 1);
 
     // 2. Create a device class (appears in /sys/class)
     good_driver_class = class_create(THIS_MODULE, CLASS_NAME);
     if (IS_ERR(good_driver_class)) {
         ret = PTR_ERR(good_driver_class);
         printk(KERN_ALERT "%s: Failed to create device class: %d\n", DEVICE_NAME, ret);
-        unregister_chrdev_region(major_minor_dev_num, 1);
+        unregister_chrdev_region(major_minor_dev_num, nr_devices);
         return ret;
     }
     printk(KERN_INFO "%s: Device class created: /sys/class/%s\n", DEVICE_NAME, CLASS_NAME);
 
-    // 3. Initialize the character device structure
-    cdev_init(&good_driver_cdev, &good_fops);
-    good_driver_cdev.owner = THIS_MODULE;
-
-    // 4. Add the character device to the kernel
-    ret = cdev_add(&good_driver_cdev, major_minor_dev_num, 1);
-    if (ret < 0) {
-        printk(KERN_ALERT "%s: Failed to add character device: %d\n", DEVICE_NAME, ret);
-        class_destroy(good_driver_class); // Clean up class
-        unregister_chrdev_region(major_minor_dev_num, 1);
-        return ret;
-    }
-    printk(KERN_INFO "%s: Character device added.\n", DEVICE_NAME);
-
-    // 5. Create the device file in /dev/ (udev will pick this up)
-    good_device = device_create(good_driver_class, NULL, major_minor_dev_num, NULL, DEVICE_NAME);
-    if (IS_ERR(good_device)) {
-        ret = PTR_ERR(good_device);
-        printk(KERN_ALERT "%s: Failed to create device: %d\n", DEVICE_NAME, ret);
-        cdev_del(&good_driver_cdev); // Clean up cdev
-        class_destroy(good_driver_class); // Clean up class
-        unregister_chrdev_region(major_minor_dev_num, 1);
-        return ret;
-    }
-    printk(KERN_INFO "%s: Device node created: /dev/%s\n", DEVICE_NAME, DEVICE_NAME);
-
-    // 6. Allocate and initialize driver-specific data
-    g_driver_data = kmalloc(sizeof(struct good_driver_data), GFP_KERNEL);
-    if (!g_driver_data) {
-        ret = -ENOMEM;
-        printk(KERN_ALERT "%s: Failed to allocate driver data structure.\n", DEVICE_NAME);
-        device_destroy(good_driver_class, major_minor_dev_num);
-        cdev_del(&good_driver_cdev);
-        class_destroy(good_driver_class);
-        unregister_chrdev_region(major_minor_dev_num, 1);
-        return ret;
-    }
-    memset(g_driver_data, 0, sizeof(struct good_driver_data)); // Zero out the structure
-
-    g_driver_data->buffer = kmalloc(BUFFER_SIZE, GFP_KERNEL);
-    if (!g_driver_data->buffer) {
-        ret = -ENOMEM;
-        printk(KERN_ALERT "%s: Failed to allocate device buffer.\n", DEVICE_NAME);
-        kfree(g_driver_data); // Free the data structure itself
-        device_destroy(good_driver_class, major_minor_dev_num);
-        cdev_del(&good_driver_cdev);
-        class_destroy(good_driver_class);
-        unregister_chrdev_region(major_minor_dev_num, 1);
-        return ret;
+    // 3. Create the devices, undoing the ones already created on failure
+    for (i = 0; i < nr_devices; i++) {
+        ret = good_create_device(i);
+        if (ret < 0) {
+            while (i--)
+                good_destroy_device(i);
+            class_destroy(good_driver_class);
+            unregister_chrdev_region(major_minor_dev_num, nr_devices);
+            return ret;
+        }
     }
-    g_driver_data->current_len = 0; // Buffer is initially empty
 
-    // Initialize the mutex
-    mutex_init(&g_driver_data->buffer_mutex);
-    printk(KERN_INFO "%s: Mutex initialized.\n", DEVICE_NAME);
+    if (ring_mode)
+        printk(KERN_INFO "%s: Ring mode: one reader and one writer stream without locking.\n", DEVICE_NAME);
+    if (read_mostly)
+        printk(KERN_INFO "%s: Read-mostly mode: readers do not take the mutex.\n", DEVICE_NAME);
+    if (private_buffers)
+        printk(KERN_INFO "%s: Every open file gets a private buffer.\n", DEVICE_NAME);
 
     printk(KERN_INFO "%s: Module loaded successfully! 🎉\n", DEVICE_NAME);
     return 0;
@@ -317,36 +1071,23 @@ static int __init good_driver_init(void) {
  * @brief Cleans up and unloads the driver module.
  */
 static void __exit good_driver_exit(void) {
+    unsigned int i;
+
     printk(KERN_INFO "%s: Exiting Good Driver module.\n", DEVICE_NAME);
 
     // Clean up in reverse order of allocation/creation
 
-    // 1. Free driver data and buffer
-    if (g_driver_data) {
-        if (g_driver_data->buffer) {
-            kfree(g_driver_data->buffer);
-            g_driver_data->buffer = NULL;
-            printk(KERN_INFO "%s: Device buffer freed.\n", DEVICE_NAME);
-        }
-        kfree(g_driver_data);
-        g_driver_data = NULL;
-        printk(KERN_INFO "%s: Driver data structure freed.\n", DEVICE_NAME);
-    }
-
-    // 2. Destroy the device file
-    device_destroy(good_driver_class, major_minor_dev_num);
-    printk(KERN_INFO "%s: Device node removed.\n", DEVICE_NAME);
-
-    // 3. Delete the character device
-    cdev_del(&good_driver_cdev);
-    printk(KERN_INFO "%s: Character device deleted.\n", DEVICE_NAME);
+    // 1. Remove the devices: device nodes, character devices, then their memory
+    for (i = nr_devices; i-- > 0;)
+        good_destroy_device(i);
+    printk(KERN_INFO "%s: Devices removed.\n", DEVICE_NAME);
 
-    // 4. Destroy the device class
+    // 2. Destroy the device class
     class_destroy(good_driver_class);
     printk(KERN_INFO "%s: Device class destroyed.\n", DEVICE_NAME);
 
-    // 5. Unregister major/minor numbers
-    unregister_chrdev_region(major_minor_dev_num, 1);
+    // 3. Unregister major/minor numbers
+    unregister_chrdev_region(major_minor_dev_num, nr_devices);
     printk(KERN_INFO "%s: Device numbers unregistered.\n", DEVICE_NAME);
 
     printk(KERN_INFO "%s: Module unloaded. Goodbye! 👋\n", DEVICE_NAME);
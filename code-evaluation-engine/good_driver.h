@@ -0,0 +1,49 @@
+#ifndef GOOD_DRIVER_H
+#define GOOD_DRIVER_H
+
+// Layout shared between good_driver (ring_mode=1) and user space through mmap.
+//
+// Mapping the device from offset 0 gives GOOD_RING_MMAP_SIZE bytes: a
+// struct good_ring_header at the start, followed by the ring data at
+// GOOD_RING_DATA_OFFSET. head and tail are free-running byte counts; the ring
+// holds head - tail bytes starting at data[tail & (GOOD_RING_SIZE - 1)].
+//
+// The first open file to write (or ring the write doorbell, below) becomes
+// the producer and owns head; the first to read (or ring the read doorbell)
+// becomes the consumer and owns tail. Each side keeps its role until it
+// closes, and another file trying the same side gets -EBUSY. A shared
+// writable mapping needs an O_RDWR open, so both sides open the device
+// O_RDWR to mmap it; the mapping itself claims nothing, so a side working
+// only through the mapping rings its doorbell once before it starts, to
+// take its role. read()/write()-only clients may open O_RDONLY or O_WRONLY.
+//
+// A user-space producer copies its bytes into data and then publishes head
+// with a release store (for example __atomic_store_n(&hdr->head, head,
+// __ATOMIC_RELEASE)); a consumer reads head with an acquire load before
+// touching data, and releases tail when done.
+// read() and write() on the same device keep working alongside the mapping.
+//
+// Sleeping read()/write() callers and poll() are only woken from inside the
+// driver. A side that moves an index through the mapping instead rings the
+// doorbell with a zero-length call: write(fd, buf, 0) after publishing head
+// wakes the reader, read(fd, buf, 0) after releasing tail wakes the writer.
+
+#include <linux/types.h>
+
+#define GOOD_RING_SIZE        4096 // Ring data bytes; a power of two
+#define GOOD_RING_CACHELINE   64
+#define GOOD_RING_DATA_OFFSET 4096 // Header page, then data
+#define GOOD_RING_MMAP_SIZE   (GOOD_RING_DATA_OFFSET + GOOD_RING_SIZE)
+
+// head and tail each get a cache line of their own so the producer's and the
+// consumer's CPUs do not keep stealing one line from each other
+struct good_ring_header {
+    __u32 head;                                          // Producer index
+    __u32 __pad0[GOOD_RING_CACHELINE / sizeof(__u32) - 1];
+    __u32 tail;                                          // Consumer index
+    __u32 __pad1[GOOD_RING_CACHELINE / sizeof(__u32) - 1];
+    __u32 size;                                          // GOOD_RING_SIZE, for sanity checks
+    __u32 data_offset;                                   // GOOD_RING_DATA_OFFSET
+};
+
+#endif // GOOD_DRIVER_H
@@ -0,0 +1,20 @@
+import os
+import subprocess
+
+
+def _git(args, cwd):
+    result = subprocess.run(["git"] + args, cwd=cwd, capture_output=True, text=True, check=True)
+    return result.stdout
+
+
+def changed_files(base_rev, head_rev=None, cwd=None):
+    # Absolute paths of files that differ between base_rev and head_rev. Without
+    # head_rev the working tree is compared, including untracked files.
+    toplevel = _git(["rev-parse", "--show-toplevel"], cwd).strip()
+    diff_args = ["diff", "--name-only", base_rev]
+    if head_rev:
+        diff_args.append(head_rev)
+    names = _git(diff_args, toplevel).splitlines()
+    if not head_rev:
+        names += _git(["ls-files", "--others", "--exclude-standard"], toplevel).splitlines()
+    return {os.path.abspath(os.path.join(toplevel, name)) for name in names if name}
@@ -1,14 +1,16 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
+#include <linux/printk.h> // pr_debug, printk_ratelimited
 #include <linux/fs.h>
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/cdev.h>
 #include <linux/device.h>
 #include <linux/mutex.h>
-#include <linux/timer.h>
+#include <linux/workqueue.h> // Deferrable delayed work for message expiry
 #include <linux/jiffies.h>
 #include <linux/string.h> // For memset, memcpy, strlen (though not always best for strings)
+#include <linux/uio.h> // iov_iter
 
 // --- Defines ---
 #define DEVICE_NAME "subtle_bad_driver"
@@ -16,6 +18,9 @@
 #define MAX_BUFFER_SIZE 256 // Small buffer, seems reasonable for simple data
 #define MESSAGE_TIMEOUT_JIFFIES (10 * HZ) // 10 seconds timeout
 
+// I/O path tracing via pr_debug (dynamic debug); error paths use printk_ratelimited
+#define subtle_trace(fmt, ...) pr_debug("%s: " fmt, DEVICE_NAME, ##__VA_ARGS__)
+
 // --- Module Information ---
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Subtle Bad Example");
@@ -32,34 +37,38 @@ struct subtle_driver_data {
     char *message_buffer;         // Dynamically allocated message buffer
     size_t message_len;           // Current length of message
     struct mutex data_mutex;      // Mutex for protecting buffer access
-    struct timer_list reset_timer; // Timer to clear message
+    struct delayed_work expire_work; // Clears an idle message in the background
     unsigned long last_write_jiffies; // Jiffies when last write occurred
 };
 
 static struct subtle_driver_data *g_subtle_data = NULL; // Global pointer to our device data
 
-// --- Timer Callback (Potential race with data_mutex) ---
-static void subtle_timer_callback(struct timer_list *t) {
-    struct subtle_driver_data *data = from_timer(data, t, reset_timer);
+// --- Message Expiry ---
 
-    // Issue 1: Timer callback attempts to acquire mutex without checking return.
-    // If a read/write operation holds the mutex, this will block.
-    // If the mutex is already locked and we're in an atomic context (unlikely for timer, but good practice to check),
-    // or if the process holding the mutex is sleeping, it can lead to deadlocks or long delays.
-    mutex_lock(&data->data_mutex); // Blocks if held, doesn't check for failure
+// A message expires MESSAGE_TIMEOUT_JIFFIES after the last write. Writes only
+// record the time; the read path checks it lazily, so an expired message is
+// never returned, and a deferrable delayed work frees the buffer contents in
+// the background without waking an idle CPU just for that. The work runs in
+// process context, so it may take data_mutex.
 
-    // Issue 2: Checks condition *after* acquiring mutex, could have done before
-    if (jiffies - data->last_write_jiffies >= MESSAGE_TIMEOUT_JIFFIES) {
-        memset(data->message_buffer, 0, MAX_BUFFER_SIZE); // Clears buffer
+// Clears the message if it has expired. Called with data_mutex held.
+static void subtle_expire_locked(struct subtle_driver_data *data) {
+    if (data->message_len && time_after_eq(jiffies, data->last_write_jiffies + MESSAGE_TIMEOUT_JIFFIES)) {
+        memset(data->message_buffer, 0, MAX_BUFFER_SIZE);
         data->message_len = 0;
-        printk(KERN_INFO "%s: Message buffer cleared by timer.\n", DEVICE_NAME);
-    } else {
-        // Issue 3: Rescheduling without thinking of potential infinite loops
-        // If system time jumps back or jiffies rolls over in a specific way,
-        // this might trigger frequently.
-        mod_timer(&data->reset_timer, jiffies + MESSAGE_TIMEOUT_JIFFIES);
+        subtle_trace("Message buffer cleared after timeout.\n");
     }
+}
 
+static void subtle_expire_work(struct work_struct *work) {
+    struct subtle_driver_data *data = container_of(to_delayed_work(work), struct subtle_driver_data, expire_work);
+
+    mutex_lock(&data->data_mutex);
+    subtle_expire_locked(data);
+    // Writes since this was queued moved the deadline: sleep until the new one
+    if (data->message_len)
+        schedule_delayed_work(&data->expire_work,
+                              data->last_write_jiffies + MESSAGE_TIMEOUT_JIFFIES - jiffies);
     mutex_unlock(&data->data_mutex);
 }
 
@@ -74,40 +83,43 @@ static int subtle_dev_open(struct inode *inode, struct file *file) {
 
     file->private_data = g_subtle_data; // Good practice to store device data
 
-    printk(KERN_INFO "%s: Device opened.\n", DEVICE_NAME);
+    subtle_trace("Device opened.\n");
     return 0;
 }
 
 static int subtle_dev_release(struct inode *inode, struct file *file) {
     module_put(THIS_MODULE); // Correctly paired with try_module_get
 
-    printk(KERN_INFO "%s: Device closed.\n", DEVICE_NAME);
+    subtle_trace("Device closed.\n");
     return 0;
 }
 
-static ssize_t subtle_dev_read(struct file *file, char __user *user_buffer, size_t len, loff_t *offset) {
-    struct subtle_driver_data *data = (struct subtle_driver_data *)file->private_data;
+static ssize_t subtle_dev_read_iter(struct kiocb *iocb, struct iov_iter *to) {
+    struct subtle_driver_data *data = (struct subtle_driver_data *)iocb->ki_filp->private_data;
+    loff_t *offset = &iocb->ki_pos;
     ssize_t bytes_to_read;
-    int ret;
+    size_t copied;
 
     if (mutex_lock_interruptible(&data->data_mutex)) {
-        printk(KERN_WARNING "%s: Read: Mutex lock interrupted.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Read: Mutex lock interrupted.\n", DEVICE_NAME);
         return -ERESTARTSYS;
     }
 
     // Issue 5: `*offset` can potentially go beyond `MAX_BUFFER_SIZE` during writes if `len` is large
     // and `offset` isn't properly bounded. This read logic could then access garbage or fault.
     // While `MIN_BUFFER_SIZE` is small, a large `len` with a large `offset` could be an issue.
-    bytes_to_read = min((size_t)(data->message_len - *offset), len);
+    subtle_expire_locked(data);
+    bytes_to_read = min((size_t)(data->message_len - *offset), iov_iter_count(to));
 
     if (*offset >= data->message_len) { // Correctly handles offset past end of data
         mutex_unlock(&data->data_mutex);
         return 0;
     }
 
-    ret = copy_to_user(user_buffer, data->message_buffer + *offset, bytes_to_read);
-    if (ret != 0) {
-        printk(KERN_ERR "%s: Read: Failed to copy %d bytes to user space.\n", DEVICE_NAME, ret);
+    copied = copy_to_iter(data->message_buffer + *offset, bytes_to_read, to);
+    if (copied != bytes_to_read) {
+        printk_ratelimited(KERN_ERR "%s: Read: Failed to copy %zd bytes to user space.\n", DEVICE_NAME,
+                           bytes_to_read - copied);
         mutex_unlock(&data->data_mutex);
         return -EFAULT;
     }
@@ -115,17 +127,18 @@ static ssize_t subtle_dev_read(struct file *file, char __user *user_buffer, size
     *offset += bytes_to_read;
     mutex_unlock(&data->data_mutex);
 
-    printk(KERN_INFO "%s: Read %zd bytes from device. Offset now %lld.\n", DEVICE_NAME, bytes_to_read, *offset);
+    subtle_trace("Read %zd bytes from device. Offset now %lld.\n", bytes_to_read, *offset);
     return bytes_to_read;
 }
 
-static ssize_t subtle_dev_write(struct file *file, const char __user *user_buffer, size_t len, loff_t *offset) {
-    struct subtle_driver_data *data = (struct subtle_driver_data *)file->private_data;
+static ssize_t subtle_dev_write_iter(struct kiocb *iocb, struct iov_iter *from) {
+    struct subtle_driver_data *data = (struct subtle_driver_data *)iocb->ki_filp->private_data;
+    loff_t *offset = &iocb->ki_pos;
     ssize_t bytes_to_write;
-    int ret;
+    size_t copied;
 
     if (mutex_lock_interruptible(&data->data_mutex)) {
-        printk(KERN_WARNING "%s: Write: Mutex lock interrupted.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Write: Mutex lock interrupted.\n", DEVICE_NAME);
         return -ERESTARTSYS;
     }
 
@@ -134,17 +147,18 @@ static ssize_t subtle_dev_write(struct file *file, const char __user *user_buffe
     // overwrite existing data without clearing it. For a simple message buffer,
     // this usually means you want to overwrite from the beginning, or append.
     // Here, it allows appending, but `message_len` only updates to *offset.
-    bytes_to_write = min((size_t)(MAX_BUFFER_SIZE - *offset), len);
+    bytes_to_write = min((size_t)(MAX_BUFFER_SIZE - *offset), iov_iter_count(from));
 
     if (bytes_to_write <= 0) {
         mutex_unlock(&data->data_mutex);
-        printk(KERN_WARNING "%s: Write: Buffer full or offset too large.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Write: Buffer full or offset too large.\n", DEVICE_NAME);
         return -ENOSPC;
     }
 
-    ret = copy_from_user(data->message_buffer + *offset, user_buffer, bytes_to_write);
-    if (ret != 0) {
-        printk(KERN_ERR "%s: Write: Failed to copy %d bytes from user space.\n", DEVICE_NAME, ret);
+    copied = copy_from_iter(data->message_buffer + *offset, bytes_to_write, from);
+    if (copied != bytes_to_write) {
+        printk_ratelimited(KERN_ERR "%s: Write: Failed to copy %zd bytes from user space.\n", DEVICE_NAME,
+                           bytes_to_write - copied);
         mutex_unlock(&data->data_mutex);
         return -EFAULT;
     }
@@ -157,15 +171,14 @@ static ssize_t subtle_dev_write(struct file *file, const char __user *user_buffe
         data->message_len = *offset;
     }
 
-    data->last_write_jiffies = jiffies; // Update last write time
-    // Issue 8: Reschedule timer on every write. This is usually fine, but if writes are very frequent,
-    // it could cause excessive timer modifications. Might be better to let it expire and reschedule only if needed.
-    // Also, assumes timer is already initialized, which it is.
-    mod_timer(&data->reset_timer, jiffies + MESSAGE_TIMEOUT_JIFFIES);
+    data->last_write_jiffies = jiffies; // Update last write time; moves the expiry deadline
+    // Only an idle expiry work needs arming; a pending one re-reads the deadline when it runs
+    if (!delayed_work_pending(&data->expire_work))
+        schedule_delayed_work(&data->expire_work, MESSAGE_TIMEOUT_JIFFIES);
 
     mutex_unlock(&data->data_mutex);
 
-    printk(KERN_INFO "%s: Written %zd bytes to device. Offset now %lld.\n", DEVICE_NAME, bytes_to_write, *offset);
+    subtle_trace("Written %zd bytes to device. Offset now %lld.\n", bytes_to_write, *offset);
     return bytes_to_write;
 }
 
@@ -174,7 +187,7 @@ static loff_t subtle_dev_llseek(struct file *file, loff_t offset, int whence) {
     loff_t new_offset = 0;
 
     if (mutex_lock_interruptible(&data->data_mutex)) {
-        printk(KERN_WARNING "%s: Lseek: Mutex lock interrupted.\n", DEVICE_NAME);
+        printk_ratelimited(KERN_WARNING "%s: Lseek: Mutex lock interrupted.\n", DEVICE_NAME);
         return -ERESTARTSYS;
     }
 
@@ -202,14 +215,14 @@ static loff_t subtle_dev_llseek(struct file *file, loff_t offset, int whence) {
     // The check `new_offset > MAX_BUFFER_SIZE` (instead of `>=`) might allow off-by-one errors.
     if (new_offset < 0 || new_offset > MAX_BUFFER_SIZE) {
         mutex_unlock(&data->data_mutex);
-        printk(KERN_WARNING "%s: Lseek: Invalid offset %lld (requested: %lld, whence: %d).\n", DEVICE_NAME, new_offset, offset, whence);
+        printk_ratelimited(KERN_WARNING "%s: Lseek: Invalid offset %lld (requested: %lld, whence: %d).\n", DEVICE_NAME, new_offset, offset, whence);
         return -EINVAL;
     }
 
     file->f_pos = new_offset;
     mutex_unlock(&data->data_mutex);
 
-    printk(KERN_INFO "%s: Seeked to offset %lld.\n", DEVICE_NAME, new_offset);
+    subtle_trace("Seeked to offset %lld.\n", new_offset);
     return new_offset;
 }
 
@@ -218,8 +231,10 @@ static const struct file_operations subtle_fops = {
     .owner = THIS_MODULE,
     .open = subtle_dev_open,
     .release = subtle_dev_release,
-    .read = subtle_dev_read,
-    .write = subtle_dev_write,
+    .read_iter = subtle_dev_read_iter, // Also serves read(), readv() and io_uring
+    .write_iter = subtle_dev_write_iter,
+    .splice_read = generic_file_splice_read, // splice()/sendfile() through read_iter (pre-6.5 helper)
+    .splice_write = iter_file_splice_write,
     .llseek = subtle_dev_llseek,
 };
 
@@ -299,12 +314,8 @@ static int __init subtle_driver_init(void) {
 
     mutex_init(&g_subtle_data->data_mutex);
 
-    // Initialize and arm the timer
-    timer_setup(&g_subtle_data->reset_timer, subtle_timer_callback, 0); // Issue 11: Flag is 0, not TI_ONESHOT
-    // Issue 12: Initializing last_write_jiffies to current jiffies, but no write has happened.
-    // If the timer fires immediately, it might clear an empty buffer prematurely.
-    g_subtle_data->last_write_jiffies = jiffies;
-    mod_timer(&g_subtle_data->reset_timer, jiffies + MESSAGE_TIMEOUT_JIFFIES); // Start the timer
+    // Armed by the first write; there is nothing to expire yet
+    INIT_DEFERRABLE_WORK(&g_subtle_data->expire_work, subtle_expire_work);
 
     printk(KERN_INFO "%s: Module loaded successfully.\n", DEVICE_NAME);
     return 0;
@@ -315,16 +326,9 @@ static int __init subtle_driver_init(void) {
 static void __exit subtle_driver_exit(void) {
     printk(KERN_INFO "%s: Exiting Subtle Bad Driver module.\n", DEVICE_NAME);
 
-    // Delete and cleanup timer
-    // Issue 13: Timer might still be running and trying to acquire mutex during cleanup.
-    // Timer should be del_timer_sync before freeing data that it accesses.
-    // If timer handler is running, del_timer() won't wait for it. del_timer_sync() would.
-    del_timer(&g_subtle_data->reset_timer); // This is not del_timer_sync()
-
     if (g_subtle_data) {
-        // Issue 14: This kfree happens immediately. If the timer callback is still running
-        // (even briefly after del_timer and before returning from its last execution),
-        // it might try to access freed memory (`g_subtle_data->message_buffer` or `g_subtle_data->data_mutex`).
+        // Waits for a running expiry work and stops it from re-queueing itself
+        cancel_delayed_work_sync(&g_subtle_data->expire_work);
         if (g_subtle_data->message_buffer) {
             kfree(g_subtle_data->message_buffer);
             g_subtle_data->message_buffer = NULL;
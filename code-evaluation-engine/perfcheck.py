@@ -0,0 +1,314 @@
+import os
+import re
+import json
+
+from chunking import mask_source, find_functions, handler_roles, fops_tables
+
+# Performance findings cppcheck has no checker for, reported in the same shape
+# as cppcheck errors so they are scored through SEVERITY_WEIGHTS like any other.
+# The checks work on the masked source (see chunking.mask_source) with
+# patterns and brace matching rather than a full C parser, which keeps the
+# pass dependency-free and fast enough to run on every file.
+
+# file_operations handlers that run once per I/O request
+HOT_HANDLERS = ('read', 'write', 'read_iter', 'write_iter', 'llseek', 'poll', 'mmap',
+                'unlocked_ioctl', 'compat_ioctl', 'splice_read', 'splice_write', 'fsync')
+
+# printk levels that are fine on a hot path: they only fire on error paths
+ERROR_LEVELS = ('KERN_EMERG', 'KERN_ALERT', 'KERN_CRIT', 'KERN_ERR', 'KERN_WARNING')
+
+_PRINTK = re.compile(r'\bprintk\s*\(\s*(\w*)')
+_INFO_LOGGERS = re.compile(r'\b(pr_info|pr_notice|pr_cont|dev_info|dev_notice|netdev_info)\s*\(')
+
+# File-scope scalar counters, plain or atomic
+_COUNTER_DECL = re.compile(r'^[ \t]*(?:static\s+)?(?:volatile\s+)?'
+                           r'(?:(?:unsigned|signed)\s+)?(?:int|long\s+long|long|short|size_t|ssize_t|'
+                           r'[us](?:8|16|32|64)|atomic_t|atomic64_t|atomic_long_t)\s+(\w+)\s*[=;]',
+                           re.MULTILINE)
+
+_SLEEPS = re.compile(r'\b(msleep|msleep_interruptible|ssleep|usleep_range|fsleep|mdelay|udelay|ndelay|'
+                     r'schedule_timeout\w*)\s*\(')
+_ALLOCATIONS = re.compile(r'\b(kmalloc|kzalloc|kcalloc|kmalloc_array|krealloc|kvmalloc|kvzalloc|vmalloc|vzalloc|'
+                          r'alloc_pages|__get_free_pages|get_zeroed_page|kmem_cache_alloc)\s*\(')
+_LOOP = re.compile(r'\b(for|while)\s*\(')
+_USER_COPIES = re.compile(r'\b(copy_to_user|copy_from_user|put_user|get_user|__put_user|__get_user|'
+                          r'copy_to_iter|copy_from_iter)\s*\(')
+_SINGLE_USER_COPY = re.compile(r'\b(?:__)?(?:put|get)_user\s*\(|'
+                               r'\bcopy_(?:to|from)_user\s*\([^;]*,\s*(?:1|sizeof\s*\(\s*(?:char|u8|__u8)\s*\))\s*\)')
+_ELEMENT_COPY = re.compile(r'^\s*[\w.\->]+\s*\[[^\]]+\]\s*=\s*[\w.\->]+\s*\[[^\]]+\]\s*;\s*$')
+_SPIN_LOCK = re.compile(r'\b(?:raw_)?(spin_lock|spin_lock_irq|spin_lock_irqsave|spin_lock_bh|read_lock|write_lock|'
+                        r'read_lock_irqsave|write_lock_irqsave|read_lock_bh|write_lock_bh)\s*\(')
+_SPIN_UNLOCK = re.compile(r'\b(?:raw_)?(?:spin|read|write)_unlock\w*\s*\(')
+
+# Regressions from a benchmarks/driver_bench report, set by configure_benchmarks()
+_benchmark_regressions = []
+
+
+def _finding(source_file, text, offset, finding_id, message):
+    line = text.count('\n', 0, offset) + 1
+    column = offset - text.rfind('\n', 0, offset)
+    return {
+        "severity": "performance",
+        "id": finding_id,
+        "message": message,
+        "verbose_message": message,
+        "file": source_file,
+        "line": line,
+        "column": column
+    }
+
+
+def _hot_handlers(text):
+    # (function name, fops role, start offset, masked body) of every
+    # per-request handler
+    masked = mask_source(text)
+    roles = handler_roles(text)
+    for name, start, end in find_functions(text):
+        role = roles.get(name)
+        if role in HOT_HANDLERS:
+            yield name, role, start, masked[start:end]
+
+
+def _matching(body, index, opening, closing):
+    # Offset just past the bracket that closes the one at index
+    depth = 0
+    for position in range(index, len(body)):
+        if body[position] == opening:
+            depth += 1
+        elif body[position] == closing:
+            depth -= 1
+            if depth == 0:
+                return position + 1
+    return len(body)
+
+
+def _is_do_while(body, while_offset):
+    # Whether the while at while_offset closes a do { } block
+    before = body[:while_offset].rstrip()
+    if not before.endswith('}'):
+        return False
+    depth = 0
+    for position in range(len(before) - 1, -1, -1):
+        if before[position] == '}':
+            depth += 1
+        elif before[position] == '{':
+            depth -= 1
+            if depth == 0:
+                return re.search(r'\bdo\s*$', before[:position]) is not None
+    return False
+
+
+def _loops(body):
+    # (offset, loop body) of for/while loops. The loop body is the braced
+    # block or single statement after the condition; the while of a
+    # do { } while (...) has none.
+    for match in _LOOP.finditer(body):
+        condition_end = _matching(body, match.end() - 1, '(', ')')
+        if match.group(1) == 'while' and _is_do_while(body, match.start()):
+            continue
+        rest = body[condition_end:]
+        stripped = rest.lstrip()
+        statement_start = condition_end + len(rest) - len(stripped)
+        if stripped.startswith('{'):
+            statement_end = _matching(body, statement_start, '{', '}')
+            yield match.start(), body[statement_start + 1:statement_end - 1]
+        else:
+            statement_end = body.find(';', statement_start)
+            yield match.start(), body[statement_start:statement_end + 1 if statement_end != -1 else len(body)]
+
+
+def hot_path_printk(source_file, text):
+    # Unconditional informational logging in per-request handlers: at high
+    # IOPS the console and log buffer locks cost more than the I/O itself.
+    # pr_debug/dev_dbg and the _ratelimited/_once variants do not match.
+    findings = []
+    for name, role, start, body in _hot_handlers(text):
+        calls = [(m.start(), "printk") for m in _PRINTK.finditer(body) if m.group(1) not in ERROR_LEVELS]
+        calls += [(m.start(), m.group(1)) for m in _INFO_LOGGERS.finditer(body)]
+        for offset, call in sorted(calls):
+            findings.append(_finding(source_file, text, start + offset, "hotPathPrintk",
+                                     f"Unconditional {call} in .{role} handler {name}(); use pr_debug/dev_dbg "
+                                     f"or a ratelimited variant on per-request paths"))
+    return findings
+
+
+def _outside_functions(masked, functions):
+    # masked with every function body blanked, leaving file scope only
+    parts = []
+    position = 0
+    for _, start, end in functions:
+        parts.append(masked[position:start])
+        parts.append(re.sub(r'[^\n]', ' ', masked[start:end]))
+        position = end
+    parts.append(masked[position:])
+    return "".join(parts)
+
+
+def _counter_updates(name):
+    name = re.escape(name)
+    return re.compile(rf'(?:\b{name}\s*(?:\+\+|--|[+\-]=)|(?:\+\+|--)\s*{name}\b|'
+                      rf'\batomic(?:64|_long)?_(?:inc|dec|add|sub)\w*\s*\([^;]*&\s*{name}\b)')
+
+
+def shared_hot_counter(source_file, text):
+    # One global counter bumped by every request bounces its cache line
+    # between all CPUs doing I/O, whether or not the update is atomic.
+    # Per-CPU counters summed on read (or per-device state) scale instead.
+    functions = find_functions(text)
+    counters = _COUNTER_DECL.findall(_outside_functions(mask_source(text), functions))
+    findings = []
+    for name, role, start, body in _hot_handlers(text):
+        for counter in counters:
+            match = _counter_updates(counter).search(body)
+            if match:
+                findings.append(_finding(source_file, text, start + match.start(), "sharedHotCounter",
+                                         f"Global counter {counter} updated in .{role} handler {name}(); "
+                                         f"every CPU doing I/O contends for its cache line, use per-CPU counters"))
+    return findings
+
+
+def legacy_file_operations(source_file, text):
+    # .read/.write without the _iter variants: readv()/writev() and io_uring
+    # go through the legacy op once per segment, and without splice handlers
+    # splice()/sendfile() cannot move data without a user-space bounce.
+    findings = []
+    for table, offset, fields in fops_tables(text):
+        legacy = [op for op in ('read', 'write') if op in fields and f"{op}_iter" not in fields]
+        if legacy:
+            ops = "/".join(f".{op}" for op in legacy)
+            findings.append(_finding(source_file, text, offset, "legacyFileOperations",
+                                     f"{table} implements only {ops}; vectored, io_uring and splice I/O are "
+                                     f"split into one call per segment, implement read_iter/write_iter"))
+    return findings
+
+
+def sleep_in_handler(source_file, text):
+    # A fixed sleep or delay in a per-request handler caps every caller's
+    # throughput at one request per delay; the *delay variants also spin
+    findings = []
+    for name, role, start, body in _hot_handlers(text):
+        for match in _SLEEPS.finditer(body):
+            findings.append(_finding(source_file, text, start + match.start(), "sleepInHandler",
+                                     f"{match.group(1)}() in .{role} handler {name}(); wait on an event "
+                                     f"(wait queue, completion) instead of a fixed delay"))
+    return findings
+
+
+def alloc_in_handler(source_file, text):
+    # Allocating on every request puts the allocator (and possibly reclaim)
+    # on the I/O path; buffers belong in the device or open-file state
+    findings = []
+    for name, role, start, body in _hot_handlers(text):
+        for match in _ALLOCATIONS.finditer(body):
+            findings.append(_finding(source_file, text, start + match.start(), "allocInHandler",
+                                     f"{match.group(1)}() on every call of .{role} handler {name}(); allocate "
+                                     f"once at init or open and reuse the buffer"))
+    return findings
+
+
+def busy_wait_loop(source_file, text):
+    # A loop with an empty body burns CPU while doing nothing useful, and the
+    # compiler may drop it altogether
+    findings = []
+    for name, role, start, body in _hot_handlers(text):
+        for offset, loop_body in _loops(body):
+            if not loop_body.strip(' \t\n;'):
+                findings.append(_finding(source_file, text, start + offset, "busyWaitLoop",
+                                         f"Empty loop in .{role} handler {name}() spins the CPU; sleep on an "
+                                         f"event or remove it"))
+    return findings
+
+
+def byte_copy_loop(source_file, text):
+    # Copying element by element, or calling a user-copy helper per element,
+    # instead of one memcpy/copy_to_user over the whole range
+    findings = []
+    for name, role, start, body in _hot_handlers(text):
+        for offset, loop_body in _loops(body):
+            if _ELEMENT_COPY.match(loop_body) or _SINGLE_USER_COPY.search(loop_body):
+                findings.append(_finding(source_file, text, start + offset, "byteCopyLoop",
+                                         f"Element-by-element copy loop in .{role} handler {name}(); copy the "
+                                         f"range with one memcpy/copy_to_user/copy_from_user call"))
+    return findings
+
+
+def copy_under_spinlock(source_file, text):
+    # User copies can fault and sleep, so they must not run with a spinlock
+    # held; even when they do not fault, every other CPU spins for the copy
+    masked = mask_source(text)
+    findings = []
+    for name, start, end in find_functions(text):
+        body = masked[start:end]
+        events = [(m.start(), 1, None) for m in _SPIN_LOCK.finditer(body)]
+        events += [(m.start(), -1, None) for m in _SPIN_UNLOCK.finditer(body)]
+        events += [(m.start(), 0, m.group(1)) for m in _USER_COPIES.finditer(body)]
+        held = 0
+        for offset, change, call in sorted(events):
+            if call and held > 0:
+                findings.append(_finding(source_file, text, start + offset, "copyUnderSpinlock",
+                                         f"{call}() in {name}() with a spinlock held; copy outside the lock "
+                                         f"or use a mutex"))
+            held = max(0, held + change)
+    return findings
+
+
+def configure_benchmarks(report_path):
+    # Loads the regressions of a driver_bench report; they are reported as
+    # findings on the source file each benchmarked driver was built from
+    global _benchmark_regressions
+    try:
+        with open(report_path, 'r') as f:
+            report = json.load(f)
+    except (OSError, json.JSONDecodeError) as e:
+        print(f"Error reading benchmark report {report_path}: {e}")
+        return False
+    _benchmark_regressions = list(report.get("regressions", []))
+    return True
+
+
+def benchmark_settings():
+    # Arguments that recreate this process's configure_benchmarks() call
+    return (_benchmark_regressions,)
+
+
+def restore_benchmark_settings(regressions):
+    global _benchmark_regressions
+    _benchmark_regressions = list(regressions)
+
+
+def benchmark_regressions(source_file, text):
+    # Measured slowdowns of the module built from this file against the
+    # baseline run, matched by file name since the report is written on the
+    # benchmark machine. Reported at the top of the file: a regression
+    # belongs to the driver as a whole, not to one line.
+    findings = []
+    for regression in _benchmark_regressions:
+        if regression.get("source") != os.path.basename(source_file):
+            continue
+        params = f" with {regression['params']}" if regression.get("params") else ""
+        findings.append(_finding(source_file, text, 0, "benchmarkRegression",
+                                 f"{regression['driver']}{params}: {regression['op']} with {regression['threads']} "
+                                 f"threads and {regression['size']}-byte I/O regressed on {regression['metric']} "
+                                 f"({regression['baseline']} -> {regression['current']})"))
+    return findings
+
+
+CHECKS = (hot_path_printk, shared_hot_counter, legacy_file_operations, sleep_in_handler, alloc_in_handler,
+          busy_wait_loop, byte_copy_loop, copy_under_spinlock, benchmark_regressions)
+
+
+def native_findings(source_file):
+    with open(source_file, 'r') as f:
+        text = f.read()
+    findings = []
+    for check in CHECKS:
+        findings.extend(check(source_file, text))
+    return findings
+
+
+def with_native_findings(source_file, cppcheck_results):
+    # cppcheck's results plus the native checks, as a new dict so memoized or
+    # cached cppcheck results are never modified. A failed cppcheck run stays None.
+    if cppcheck_results is None:
+        return None
+    return {"errors": list(cppcheck_results.get("errors", [])) + native_findings(source_file)}
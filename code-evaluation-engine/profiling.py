@@ -0,0 +1,102 @@
+import json
+import time
+import threading
+import contextlib
+
+# Per-file stage timings (seconds, keys ending in _s) and token counts. The
+# pipeline records into whichever profile dict is bound to the current thread;
+# with none bound, recording is a no-op.
+
+_local = threading.local()
+_lock = threading.Lock()
+
+PERCENTILES = (50, 95, 99)
+
+
+def current():
+    return getattr(_local, "profile", None)
+
+
+@contextlib.contextmanager
+def collecting(profile):
+    previous = current()
+    _local.profile = profile
+    try:
+        yield profile
+    finally:
+        _local.profile = previous
+
+
+def bound(profile, function):
+    # Wraps function so it records into profile on whatever thread runs it
+    def run(*args, **kwargs):
+        with collecting(profile):
+            return function(*args, **kwargs)
+    return run
+
+
+def add(name, value):
+    profile = current()
+    if profile is not None and value is not None:
+        with _lock:
+            profile[name] = profile.get(name, 0) + value
+
+
+@contextlib.contextmanager
+def timed(name):
+    start = time.perf_counter()
+    try:
+        yield
+    finally:
+        add(name, time.perf_counter() - start)
+
+
+def record_usage(response):
+    # Token counts from a Gemini response's usage metadata, when it has any
+    usage = getattr(response, "usage_metadata", None)
+    if usage is None:
+        return
+    add("prompt_tokens", getattr(usage, "prompt_token_count", None))
+    add("output_tokens", getattr(usage, "candidates_token_count", None))
+    add("thinking_tokens", getattr(usage, "thoughts_token_count", None))
+    add("cached_tokens", getattr(usage, "cached_content_token_count", None))
+
+
+def percentile(sorted_values, pct):
+    # Nearest-rank percentile of an already sorted list
+    rank = max(1, -(-len(sorted_values) * pct // 100))
+    return sorted_values[int(rank) - 1]
+
+
+def summarize(profiles):
+    metrics = {}
+    for profile in profiles:
+        for name, value in profile.items():
+            if isinstance(value, (int, float)) and not isinstance(value, bool):
+                metrics.setdefault(name, []).append(value)
+
+    summary = {}
+    for name in sorted(metrics):
+        values = sorted(metrics[name])
+        summary[name] = {"count": len(values), "mean": sum(values) / len(values)}
+        for pct in PERCENTILES:
+            summary[name][f"p{pct}"] = percentile(values, pct)
+        summary[name]["max"] = values[-1]
+    return summary
+
+
+def format_table(summary):
+    columns = ["count", "mean"] + [f"p{pct}" for pct in PERCENTILES] + ["max"]
+    lines = [f"{'metric':<18}" + "".join(f"{column:>12}" for column in columns)]
+    for name, stats in summary.items():
+        cells = []
+        for column in columns:
+            value = stats[column]
+            cells.append(f"{value:>12d}" if column == "count" else f"{value:>12.3f}")
+        lines.append(f"{name:<18}" + "".join(cells))
+    return "\n".join(lines)
+
+
+def export(path, profiles, summary):
+    with open(path, 'w') as f:
+        json.dump({"files": profiles, "summary": summary}, f, indent=2)
@@ -1,27 +1,243 @@
 from google import genai
+from google.genai import types
 import re
 import os
+import json
+import time
+import threading
 from dotenv import load_dotenv
 
+import profiling
+from ratelimit import RateLimiter, call_with_retries, estimate_tokens
+
 load_dotenv()
 
 api_key = os.getenv("api_key")
 
+MODEL_NAME = "gemini-2.5-flash"
+
+# Default cap on requests a single process keeps in flight against the API
+DEFAULT_MAX_IN_FLIGHT = 8
+
+# One client per process, reused for every request so its HTTP connection pool
+# (and the TLS sessions in it) stays warm. It is rebuilt after a fork, since
+# pooled sockets must not be shared between processes.
+_client = None
+_client_pid = None
+_client_lock = threading.Lock()
+_in_flight = threading.BoundedSemaphore(DEFAULT_MAX_IN_FLIGHT)
+_limiter = RateLimiter()
+_max_attempts = 5
+
+
+def configure_client(max_in_flight=DEFAULT_MAX_IN_FLIGHT, requests_per_minute=None, tokens_per_minute=None,
+                     max_attempts=5):
+    # Called by the orchestrator before any request is made in this process.
+    # The rate limits are this process's share of the quota.
+    global _in_flight, _limiter, _max_attempts
+    _in_flight = threading.BoundedSemaphore(max_in_flight)
+    _limiter = RateLimiter(requests_per_minute, tokens_per_minute)
+    _max_attempts = max_attempts
+
+
+def get_client():
+    global _client, _client_pid
+    with _client_lock:
+        if _client is None or _client_pid != os.getpid():
+            _client = genai.Client(api_key=api_key)
+            _client_pid = os.getpid()
+        return _client
+
+
+def request_slot():
+    # Held for the duration of each API request to bound concurrency
+    return _in_flight
+
+
+def _send(request, *prompt_parts):
+    # Every generation request goes through the quota buckets and retry
+    # scheduler; the in-flight slot is only held while a request is on the wire
+    def attempt():
+        with request_slot():
+            return request()
+    with profiling.timed("llm_request_s"):
+        response = call_with_retries(attempt, _limiter, estimate_tokens(*prompt_parts), max_attempts=_max_attempts)
+    profiling.record_usage(response)
+    return response
+
+
+# The required `score: x/100` line, matched strictly so it can be applied to a
+# partially received response without picking up a truncated number
+FINAL_SCORE_PATTERN = re.compile(r'score:\s*(\d+)(?:\.\d+)?\s*/\s*100', re.IGNORECASE)
+
+# Sent with stop_on_score: prompt.txt puts the score line after the full
+# report, which would leave nothing to stop early
+SCORE_FIRST_DIRECTIVE = """**REPORTING OVERRIDE**
+
+Swap the two parts of the reporting protocol: begin your response with the final weighted score line, in the exact format `score: x/100`, and only then write the JSON object."""
+
+# Characters kept from the previous chunk when scanning a stream, so a score
+# line split across two chunks is still found
+STREAM_SCAN_OVERLAP = 32
+
+
+def _build_prompt(source_file_path, prompt_template_path):
+    with profiling.timed("prompt_build_s"):
+        with open(source_file_path, 'r') as file:
+            source_code = file.read()
+        with open(prompt_template_path, 'r') as f:
+            prompt_template = f.read()
+        return prompt_template.replace('{source_code}', source_code)
+
 
 def run_qualitative_analysis(source_file_path, prompt_template_path):
-    with open(source_file_path, 'r') as file:
-        source_code = file.read()
-    with open(prompt_template_path, 'r') as f:
-        prompt_template = f.read()
-    prompt = prompt_template.replace('{source_code}', source_code)
-    client = genai.Client(api_key=api_key)
-    response = client.models.generate_content(
-        model="gemini-2.5-flash",
+    prompt = _build_prompt(source_file_path, prompt_template_path)
+    response = _send(lambda: get_client().models.generate_content(
+        model=MODEL_NAME,
         contents=prompt,
-    )
+    ), prompt)
     return response.text
 
 
+# --- Structured judging ---
+# The judge returns only per-pillar scores through a response schema and the
+# weighted total is computed here, so there is no free-text score to scrape.
+
+PILLAR_WEIGHTS = {
+    'correctness': 40,
+    'security': 25,
+    'code_quality': 20,
+    'performance': 10,
+    'advanced_features': 5
+}
+
+STRUCTURED_DIRECTIVE = """**REPORTING OVERRIDE**
+
+Ignore Part 2 of the reporting protocol: do not calculate or print a final weighted score, it is computed from your pillar scores. Return only the JSON object described by the response schema, with the pillars named {pillars}."""
+
+SCORES_ONLY_DIRECTIVE = "Leave out summaries and rationales; only the numeric `category_score` of each pillar is needed."
+
+
+def _structured_schema(include_rationale=True):
+    pillar_properties = {"category_score": {"type": "NUMBER"}}
+    if include_rationale:
+        pillar_properties["summary"] = {"type": "STRING"}
+    pillar_schema = {"type": "OBJECT", "properties": pillar_properties, "required": list(pillar_properties)}
+    return {
+        "type": "OBJECT",
+        "properties": {pillar: pillar_schema for pillar in PILLAR_WEIGHTS},
+        "required": list(PILLAR_WEIGHTS)
+    }
+
+
+CHUNK_DIRECTIVE = """**SCOPE OVERRIDE**
+
+The code above is one unit of a larger driver: the file's declarations, globals and `file_operations` table, followed by the function(s) under review after the `{marker}` line. Score every pillar for the function(s) under review only; the rest is context. Judge `advanced_features` and `performance` by what these functions could reasonably be expected to do, not by features that belong elsewhere in the driver."""
+
+CHUNK_MARKER = "/* ---- unit under review: {name} ---- */"
+
+
+def build_chunk_source(context, unit):
+    return context + "\n\n" + CHUNK_MARKER.format(name=unit["name"]) + "\n" + unit["text"]
+
+
+def run_structured_qualitative_analysis(source_file_path, prompt_template_path, include_rationale=True):
+    prompt = _build_prompt(source_file_path, prompt_template_path)
+    return _structured_request(prompt, include_rationale)
+
+
+def run_structured_chunk_analysis(context, unit, prompt_template_path, include_rationale=False):
+    # Judges one chunking unit (see chunking.split_source) with the file's
+    # context, returning the same JSON as run_structured_qualitative_analysis
+    with profiling.timed("prompt_build_s"):
+        with open(prompt_template_path, 'r') as f:
+            prompt_template = f.read()
+        prompt = prompt_template.replace('{source_code}', build_chunk_source(context, unit))
+        prompt += "\n\n" + CHUNK_DIRECTIVE.format(marker=CHUNK_MARKER.format(name=unit["name"]))
+    return _structured_request(prompt, include_rationale)
+
+
+def _structured_request(prompt, include_rationale=True):
+    prompt += "\n\n" + STRUCTURED_DIRECTIVE.format(pillars=", ".join(f"`{p}`" for p in PILLAR_WEIGHTS))
+    if not include_rationale:
+        prompt += " " + SCORES_ONLY_DIRECTIVE
+    response = _send(lambda: get_client().models.generate_content(
+        model=MODEL_NAME,
+        contents=prompt,
+        config=types.GenerateContentConfig(
+            response_mime_type="application/json",
+            response_schema=_structured_schema(include_rationale),
+        ),
+    ), prompt)
+    return response.text
+
+
+def parse_structured_verdict(analysis_text):
+    # Returns {"overall_score": 0-100, "pillars": {pillar: 0.0-1.0}} or {"error": reason}
+    try:
+        verdict = json.loads(analysis_text or "")
+    except ValueError as e:
+        return {"error": f"response is not valid JSON: {e}"}
+    if not isinstance(verdict, dict):
+        return {"error": "response is not a JSON object"}
+
+    pillars = {}
+    for pillar in PILLAR_WEIGHTS:
+        entry = verdict.get(pillar)
+        score = entry.get("category_score") if isinstance(entry, dict) else None
+        if not isinstance(score, (int, float)) or isinstance(score, bool) or not 0.0 <= score <= 1.0:
+            return {"error": f"missing or out-of-range category_score for {pillar}"}
+        pillars[pillar] = float(score)
+
+    overall_score = sum(pillars[pillar] * weight for pillar, weight in PILLAR_WEIGHTS.items())
+    return {"overall_score": round(overall_score, 2), "pillars": pillars}
+
+
+def find_final_score(analysis_text):
+    match = FINAL_SCORE_PATTERN.search(analysis_text)
+    if match:
+        score = int(match.group(1))
+        if 0 <= score <= 100:
+            return score
+    return None
+
+
+def stream_qualitative_analysis(source_file_path, prompt_template_path, stop_on_score=False):
+    # Consumes the response as it is generated. With stop_on_score the judge
+    # is asked for the score line first and the stream is closed as soon as
+    # it has arrived, so the report after it is neither waited for nor generated.
+    prompt = _build_prompt(source_file_path, prompt_template_path)
+    if stop_on_score:
+        prompt += "\n\n" + SCORE_FIRST_DIRECTIVE
+    def consume():
+        # A retry restarts the stream, so text from a failed attempt is dropped
+        analysis_text = ""
+        last_chunk = None
+        start = time.perf_counter()
+        stream = get_client().models.generate_content_stream(
+            model=MODEL_NAME,
+            contents=prompt,
+        )
+        try:
+            for chunk in stream:
+                if last_chunk is None:
+                    profiling.add("llm_ttft_s", time.perf_counter() - start)
+                last_chunk = chunk
+                scan_from = max(0, len(analysis_text) - STREAM_SCAN_OVERLAP)
+                analysis_text += chunk.text or ""
+                if stop_on_score and find_final_score(analysis_text[scan_from:]) is not None:
+                    profiling.add("llm_score_seen_s", time.perf_counter() - start)
+                    break
+        finally:
+            if hasattr(stream, "close"):
+                stream.close()
+        # Usage metadata arrives on the final chunks
+        profiling.record_usage(last_chunk)
+        return analysis_text
+
+    return _send(consume, prompt)
+
+
 def parse_qualitative_score(analysis_text):
     score_patterns = [
         r'(?:score|rating)[:\s]*(\d+)(?:/100)?',
@@ -37,3 +253,130 @@ def parse_qualitative_score(analysis_text):
                 return score
 
     return 50
+
+
+# --- Batched judging ---
+# Several drivers share one request: the rubric from prompt.txt becomes the
+# system instruction (cached server-side when the API allows it) and the
+# drivers follow in the user turn, each under its own file id.
+
+BATCH_CODE_BLOCK = re.compile(r"```c\s*\{source_code\}\s*```")
+
+BATCH_DIRECTIVE = """**BATCH PROTOCOL**
+
+Several independent drivers are supplied below, each introduced by a line of the form `=== FILE <id>: <name> ===`. Audit every driver on its own against the rubric; never let one file influence another's score.
+
+Instead of the two-part report, respond with a single JSON object of the form:
+{"files": [{"id": "<id>", "score": <final weighted score, integer 0-100>}, ...]}
+with exactly one entry per supplied file id, and nothing outside the JSON object."""
+
+BATCH_POLL_SECONDS = 30
+
+_rubric_cache_names = {}
+
+
+def build_batch_rubric(prompt_template):
+    rubric = BATCH_CODE_BLOCK.sub("(Supplied in the batch below.)", prompt_template)
+    return rubric.replace('{source_code}', '') + "\n\n" + BATCH_DIRECTIVE
+
+
+def build_batch_contents(source_file_paths):
+    sections = []
+    for index, path in enumerate(source_file_paths):
+        with open(path, 'r') as file:
+            source_code = file.read()
+        sections.append(f"=== FILE F{index}: {os.path.basename(path)} ===\n```c\n{source_code}\n```")
+    return "\n\n".join(sections)
+
+
+def _cached_rubric(client, rubric):
+    # Returns the name of a server-side cache holding the rubric, or None when
+    # context caching is unavailable (e.g. the rubric is under the minimum size)
+    if rubric not in _rubric_cache_names:
+        try:
+            cache = client.caches.create(
+                model=MODEL_NAME,
+                config=types.CreateCachedContentConfig(system_instruction=rubric, ttl="3600s"),
+            )
+            _rubric_cache_names[rubric] = cache.name
+        except Exception:
+            _rubric_cache_names[rubric] = None
+    return _rubric_cache_names[rubric]
+
+
+def run_batched_qualitative_analysis(source_file_paths, prompt_template_path):
+    with open(prompt_template_path, 'r') as f:
+        rubric = build_batch_rubric(f.read())
+    contents = build_batch_contents(source_file_paths)
+    client = get_client()
+
+    with request_slot():
+        cache_name = _cached_rubric(client, rubric)
+    if cache_name:
+        config = types.GenerateContentConfig(cached_content=cache_name, response_mime_type="application/json")
+    else:
+        config = types.GenerateContentConfig(system_instruction=rubric, response_mime_type="application/json")
+    response = _send(lambda: client.models.generate_content(
+        model=MODEL_NAME,
+        contents=contents,
+        config=config,
+    ), rubric, contents)
+    return response.text
+
+
+def parse_batch_scores(analysis_text, file_count):
+    # One entry per file in request order; None where the judge gave no usable score
+    scores = [None] * file_count
+    text = (analysis_text or "").strip()
+    text = re.sub(r"^```(?:json)?\s*|\s*```$", "", text)
+    try:
+        entries = json.loads(text).get("files", [])
+    except (ValueError, AttributeError):
+        return scores
+
+    for entry in entries:
+        if not isinstance(entry, dict):
+            continue
+        match = re.fullmatch(r"F(\d+)", str(entry.get("id", "")))
+        score = entry.get("score")
+        if match and isinstance(score, (int, float)) and 0 <= score <= 100:
+            index = int(match.group(1))
+            if index < file_count:
+                scores[index] = int(round(score))
+    return scores
+
+
+def submit_batch_job(file_groups, prompt_template_path):
+    # Queues one packed request per group on the asynchronous batch API and
+    # returns the job name; results are collected with wait_for_batch_job
+    with open(prompt_template_path, 'r') as f:
+        rubric = build_batch_rubric(f.read())
+    requests = []
+    for group in file_groups:
+        requests.append({
+            "contents": [{"role": "user", "parts": [{"text": build_batch_contents(group)}]}],
+            "config": {"system_instruction": rubric, "response_mime_type": "application/json"},
+        })
+    # Batch jobs are billed against a separate quota, so only the retries apply
+    job = call_with_retries(
+        lambda: get_client().batches.create(model=MODEL_NAME, src=requests, config={"display_name": "driver-analyzer"}),
+        RateLimiter(), 0, max_attempts=_max_attempts)
+    return job.name
+
+
+def wait_for_batch_job(job_name, poll_seconds=BATCH_POLL_SECONDS):
+    # Returns the response text of each request in submission order (None for
+    # requests that failed); raises if the job as a whole did not succeed
+    client = get_client()
+    job = client.batches.get(name=job_name)
+    while job.state.name not in ("JOB_STATE_SUCCEEDED", "JOB_STATE_FAILED",
+                                 "JOB_STATE_CANCELLED", "JOB_STATE_EXPIRED"):
+        time.sleep(poll_seconds)
+        job = client.batches.get(name=job_name)
+    if job.state.name != "JOB_STATE_SUCCEEDED":
+        raise RuntimeError(f"Batch job {job_name} ended in state {job.state.name}")
+
+    texts = []
+    for inlined in job.dest.inlined_responses:
+        texts.append(inlined.response.text if inlined.response is not None else None)
+    return texts
@@ -1,17 +1,247 @@
+import os
+import fcntl
 import subprocess
+import tempfile
 import xml.etree.ElementTree as ET
+import re
 import json
+import time
+from collections import OrderedDict
+from functools import lru_cache
 
-def run_cppcheck(source_file_or_dir, output_xml="cppcheck_report.xml", enable_checks="all"):
+import profiling
 
-    command = [
-        "cppcheck",
-        source_file_or_dir,
-        f"--enable={enable_checks}",
-        "--xml", 
-        f"--output-file={output_xml}", 
-        "-q"                  
-    ]
+# Penalty per finding, by cppcheck severity; severities not listed cost 1.
+# none and debug messages describe the checker run, not the code.
+SEVERITY_WEIGHTS = {
+    'none': 0,
+    'error': 10,
+    'warning': 5,
+    'style': 2,
+    'performance': 3,
+    'portability': 2,
+    'information': 1,
+    'debug': 0
+}
+IGNORED_IDS = ('checkersReport', 'missingIncludeSystem')
+
+# Penalty per performance finding, by id, overriding SEVERITY_WEIGHTS['performance'].
+# These come from perfcheck.py; anything that stalls every request costs
+# about as much as a warning (so does a slowdown measured by driver_bench),
+# and a user copy under a spinlock as much as an error.
+PERFORMANCE_WEIGHTS = {
+    'copyUnderSpinlock': 10,
+    'sleepInHandler': 8,
+    'benchmarkRegression': 8,
+    'busyWaitLoop': 8,
+    'allocInHandler': 4,
+    'byteCopyLoop': 4,
+    'hotPathPrintk': 3,
+    'sharedHotCounter': 3,
+    'legacyFileOperations': 2
+}
+
+# Checker families passed to --enable, by profile. "scoring" keeps the
+# families that carry a real weight in SEVERITY_WEIGHTS (errors are always
+# on) and skips information (missingInclude*, checkersReport) as well as the
+# whole-program unusedFunction pass.
+CHECK_PROFILES = {
+    'all': 'all',
+    'scoring': 'warning,style,performance,portability'
+}
+
+# Set by configure_cppcheck(); apply to every run in this process
+_check_profile = 'all'
+_setup_args = []
+_build_dir = None
+# This process's subdirectory of _build_dir, as (pid, path, open lock file)
+_build_slot = None
+
+# Results of recent analyze_source() runs, keyed by file identity and flags
+ANALYZED_CACHE_SIZE = 256
+_analyzed = OrderedDict()
+
+
+@lru_cache(maxsize=None)
+def cppcheck_version():
+    try:
+        result = subprocess.run(["cppcheck", "--version"], capture_output=True, text=True, check=True)
+        return result.stdout.strip()
+    except (subprocess.CalledProcessError, FileNotFoundError):
+        return "unknown"
+
+def configure_cppcheck(check_profile='all', kernel_dir=None, arch='x86', build_dir=None):
+    # Called by the orchestrator (and in each worker) before any run.
+    # build_dir turns on cppcheck's own incremental analysis cache; each
+    # process analyzes in a subdirectory of its own, see _process_build_dir().
+    global _check_profile, _setup_args, _build_dir
+    _check_profile = check_profile
+    _setup_args = kernel_setup_args(kernel_dir, arch) if kernel_dir else []
+    _build_dir = build_dir
+    if build_dir:
+        os.makedirs(build_dir, exist_ok=True)
+
+
+def cppcheck_settings():
+    # Arguments that recreate this process's configure_cppcheck() call
+    return _check_profile, _setup_args, _build_dir
+
+
+def restore_cppcheck_settings(check_profile, setup_args, build_dir):
+    global _check_profile, _setup_args, _build_dir
+    _check_profile, _setup_args, _build_dir = check_profile, list(setup_args), build_dir
+
+
+def kernel_setup_args(kernel_dir, arch='x86'):
+    # Include paths and defines of a prepared kernel tree (after `make prepare`),
+    # so kernel headers resolve and cppcheck checks the one configuration the
+    # module is built with instead of every #ifdef combination it can find
+    include_dirs = ["arch/{arch}/include", "arch/{arch}/include/generated", "include",
+                    "arch/{arch}/include/uapi", "arch/{arch}/include/generated/uapi", "include/uapi",
+                    "include/generated/uapi"]
+    args = ["-D__KERNEL__", "-DMODULE"]
+    for include_dir in include_dirs:
+        path = os.path.join(kernel_dir, include_dir.format(arch=arch))
+        if os.path.isdir(path):
+            args.append(f"-I{path}")
+    kconfig = os.path.join(kernel_dir, "include", "linux", "kconfig.h")
+    if os.path.isfile(kconfig):
+        args.append(f"--include={kconfig}")
+    return args
+
+
+_LOCAL_INCLUDE = re.compile(r'^[ \t]*#[ \t]*include[ \t]*"([^"]+)"', re.MULTILINE)
+
+
+def local_includes(source_file):
+    # Quoted #include files that resolve next to the including file, followed
+    # transitively, as sorted absolute paths. cppcheck reads these too, so
+    # they are part of a file's input; headers found through -I are not.
+    found = set()
+    pending = [os.path.abspath(source_file)]
+    while pending:
+        current = pending.pop()
+        try:
+            with open(current, 'r', errors='replace') as f:
+                text = f.read()
+        except OSError:
+            continue
+        for name in _LOCAL_INCLUDE.findall(text):
+            path = os.path.normpath(os.path.join(os.path.dirname(current), name))
+            if path not in found and os.path.isfile(path):
+                found.add(path)
+                pending.append(path)
+    found.discard(os.path.abspath(source_file))
+    return sorted(found)
+
+
+def has_whole_program_checks(enable_checks=None):
+    # unusedFunction looks at every file of a run together, so in a batch a
+    # use in one file hides the finding in another, and with -j it is
+    # skipped altogether; run_cppcheck_many cannot match single-file runs then
+    enable_checks = enable_checks or CHECK_PROFILES[_check_profile]
+    return any(check in ('all', 'unusedFunction') for check in enable_checks.split(','))
+
+
+def cppcheck_flags(enable_checks=None):
+    # Every flag that can change the findings, in a stable order for cache keys
+    enable_checks = enable_checks or CHECK_PROFILES[_check_profile]
+    return [f"--enable={enable_checks}"] + _setup_args + ["--xml", "-q"]
+
+
+def _process_build_dir():
+    # cppcheck does not lock its build dir, so concurrent runs sharing one
+    # overwrite each other's files. Each process claims the first slot-N
+    # subdirectory no other live process holds and keeps its lock until it
+    # exits; the next run (or worker pool) finds the same slots and their
+    # cached analysis again. A forked worker inherits the parent's claim
+    # and has to make its own.
+    global _build_slot
+    if _build_slot is not None and _build_slot[0] == os.getpid():
+        return _build_slot[1]
+    slot = 0
+    while True:
+        path = os.path.join(_build_dir, f"slot-{slot}")
+        try:
+            os.makedirs(path, exist_ok=True)
+            lock = open(os.path.join(path, ".lock"), 'a')
+        except OSError as e:
+            print(f"Warning: cannot use cppcheck build dir {path}: {e}")
+            return None
+        try:
+            fcntl.flock(lock, fcntl.LOCK_EX | fcntl.LOCK_NB)
+        except OSError:
+            lock.close()
+            slot += 1
+            continue
+        _build_slot = (os.getpid(), path, lock)
+        return path
+
+
+def _command(target_args, enable_checks=None, extra_args=()):
+    command = ["cppcheck"] + list(target_args) + cppcheck_flags(enable_checks) + list(extra_args)
+    build_dir = _process_build_dir() if _build_dir else None
+    if build_dir:
+        command.append(f"--cppcheck-build-dir={build_dir}")
+    return command
+
+
+def _error_from_element(error_element):
+    severity = error_element.get("severity")
+    msg_id = error_element.get("id")
+    message = error_element.get("msg")
+    verbose_msg = error_element.get("verbose")
+
+    location = error_element.find("location")
+    if location is not None:
+        file_path = location.get("file")
+        line_num = int(location.get("line", 0))
+        column = int(location.get("column", 0))
+    else:
+        file_path, line_num, column = "N/A", 0, 0
+
+    return {
+        "severity": severity,
+        "id": msg_id,
+        "message": message,
+        "verbose_message": verbose_msg,
+        "file": file_path,
+        "line": line_num,
+        "column": column
+    }
+
+
+def _iter_cppcheck_errors(xml_source):
+    # Yields (analysed source, error) pairs. cppcheck sets file0 on an error
+    # when its location lies in a header pulled in by that source.
+    # Time spent converting elements is recorded as xml_parse_s; waiting on
+    # cppcheck for more output is not counted
+    for _, element in ET.iterparse(xml_source, events=("end",)):
+        if element.tag == "error":
+            start = time.perf_counter()
+            error = _error_from_element(element)
+            origin = element.get("file0")
+            if origin is None and element.find("location") is not None:
+                origin = error["file"]
+            element.clear()
+            profiling.add("xml_parse_s", time.perf_counter() - start)
+            yield origin, error
+
+
+def parse_cppcheck_xml(xml_source):
+    # xml_source is a path or a binary stream; elements are converted and
+    # discarded as soon as they close so the report is never held in full
+    return [error for _, error in _iter_cppcheck_errors(xml_source)]
+
+
+def run_cppcheck(source_file_or_dir, output_xml=None, enable_checks=None):
+    # With output_xml=None the XML report is read straight from cppcheck's
+    # stderr; otherwise it is written to output_xml and parsed from there.
+    # enable_checks=None uses the configured check profile.
+    if output_xml is None:
+        return _run_cppcheck_streaming(source_file_or_dir, enable_checks)
+
+    command = _command([source_file_or_dir], enable_checks, [f"--output-file={output_xml}"])
 
     try:
 
@@ -20,36 +250,7 @@ def run_cppcheck(source_file_or_dir, output_xml="cppcheck_report.xml", enable_ch
         if result.stderr:
             print("Cppcheck stderr (non-XML output, if any):\n", result.stderr)
 
-
-        tree = ET.parse(output_xml)
-        root = tree.getroot()
-
-        errors = []
-        for error_element in root.findall(".//error"):
-
-            severity = error_element.get("severity")
-            msg_id = error_element.get("id")
-            message = error_element.get("msg")
-            verbose_msg = error_element.get("verbose")
-
-            location = error_element.find("location")
-            if location is not None:
-                file_path = location.get("file")
-                line_num = int(location.get("line", 0))
-                column = int(location.get("column", 0))
-            else:
-                file_path, line_num, column = "N/A", 0, 0
-
-            errors.append({
-                "severity": severity,
-                "id": msg_id,
-                "message": message,
-                "verbose_message": verbose_msg,
-                "file": file_path,
-                "line": line_num,
-                "column": column
-            })
-        return {"errors": errors}
+        return {"errors": parse_cppcheck_xml(output_xml)}
 
     except subprocess.CalledProcessError as e:
         print(f"Error running Cppcheck: {e}")
@@ -61,4 +262,151 @@ def run_cppcheck(source_file_or_dir, output_xml="cppcheck_report.xml", enable_ch
         return None
     except ET.ParseError:
         print(f"Error parsing Cppcheck XML report from {output_xml}. Check if the file was generated correctly.")
-        return None
\ No newline at end of file
+        return None
+
+
+def _run_cppcheck_streaming(source_file_or_dir, enable_checks=None):
+    command = _command([source_file_or_dir], enable_checks)
+
+    try:
+        process = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+    except FileNotFoundError:
+        print("Error: cppcheck command not found. Make sure it's installed and in your PATH.")
+        return None
+
+    try:
+        errors = parse_cppcheck_xml(process.stderr)
+    except ET.ParseError:
+        process.kill()
+        print("Error parsing Cppcheck XML report from its output stream.")
+        return None
+    finally:
+        process.stderr.close()
+        returncode = process.wait()
+
+    if returncode != 0:
+        print(f"Error running Cppcheck: exit status {returncode}")
+        return None
+    return {"errors": errors}
+
+
+def finding_penalty(error):
+    if error.get('id') in IGNORED_IDS:
+        return 0
+    severity = error.get('severity', 'unknown')
+    if severity == 'performance' and error.get('id') in PERFORMANCE_WEIGHTS:
+        return PERFORMANCE_WEIGHTS[error['id']]
+    return SEVERITY_WEIGHTS.get(severity, 1)
+
+
+def penalties_by_severity(cppcheck_results):
+    # {severity: total penalty}, for the severities that cost anything
+    penalties = {}
+    for error in (cppcheck_results or {}).get('errors', []):
+        penalty = finding_penalty(error)
+        if penalty:
+            severity = error.get('severity', 'unknown')
+            penalties[severity] = penalties.get(severity, 0) + penalty
+    return penalties
+
+
+def finding_rows(cppcheck_results):
+    # Compact [severity, id, line] triples of the findings that are scored
+    return [[error.get('severity', 'unknown'), error.get('id'), error.get('line')]
+            for error in (cppcheck_results or {}).get('errors', []) if error.get('id') not in IGNORED_IDS]
+
+
+def score_cppcheck_results(cppcheck_results):
+    # 0-100 quality score: 100 minus the severity penalties of every finding
+    if not cppcheck_results or 'errors' not in cppcheck_results:
+        return 100
+
+    total_penalty = sum(finding_penalty(error) for error in cppcheck_results['errors'])
+    return max(0, 100 - total_penalty)
+
+
+def _analyzed_key(source_file, enable_checks):
+    # An edited local header changes the findings as much as the file itself
+    try:
+        stats = [(path, os.stat(path).st_mtime_ns, os.stat(path).st_size)
+                 for path in [source_file] + local_includes(source_file)]
+    except OSError:
+        return None
+    return (tuple(stats), tuple(cppcheck_flags(enable_checks)))
+
+
+def _remember_analysis(key, results):
+    if key is None:
+        return
+    _analyzed[key] = results
+    if len(_analyzed) > ANALYZED_CACHE_SIZE:
+        _analyzed.popitem(last=False)
+
+
+def analyze_source(source_file, enable_checks=None):
+    # run_cppcheck at most once per process for a given file state, so tools
+    # sharing a process (the orchestrator, the standalone scorer) reuse one run.
+    # Failed runs are not remembered.
+    source_file = os.path.abspath(source_file)
+    key = _analyzed_key(source_file, enable_checks)
+    if key is None:
+        print(f"Error: cannot read {source_file}")
+        return None
+    if key in _analyzed:
+        _analyzed.move_to_end(key)
+        return _analyzed[key]
+
+    results = run_cppcheck(source_file, enable_checks=enable_checks)
+    if results is not None:
+        _remember_analysis(key, results)
+    return results
+
+
+def run_cppcheck_many(source_files, enable_checks=None, jobs=None):
+    # One cppcheck process over the whole batch, split back into per-file
+    # results keyed by the paths passed in. Errors without a location (such
+    # as checkersReport) describe the run itself and are given to every file,
+    # matching what a single-file run reports. Only meant for profiles
+    # without whole-program checks (see has_whole_program_checks()); even
+    # then cppcheck's cross-file (CTU) checks see the whole batch and may
+    # differ where one file calls into another.
+    results = {os.path.abspath(path): {"errors": []} for path in source_files}
+    keys = {path: _analyzed_key(path, enable_checks) for path in results}
+    fd, file_list = tempfile.mkstemp(suffix=".txt", prefix="cppcheck_files_")
+    with os.fdopen(fd, 'w') as f:
+        f.write("\n".join(results) + "\n")
+
+    command = _command([f"--file-list={file_list}"], enable_checks, [f"-j{jobs}"] if jobs else [])
+
+    try:
+        try:
+            process = subprocess.Popen(command, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        except FileNotFoundError:
+            print("Error: cppcheck command not found. Make sure it's installed and in your PATH.")
+            return None
+
+        try:
+            for origin, error in _iter_cppcheck_errors(process.stderr):
+                if origin is None:
+                    for file_results in results.values():
+                        file_results["errors"].append(dict(error))
+                    continue
+                file_results = results.get(os.path.abspath(origin))
+                if file_results is not None:
+                    file_results["errors"].append(error)
+        except ET.ParseError:
+            process.kill()
+            print("Error parsing Cppcheck XML report from its output stream.")
+            return None
+        finally:
+            process.stderr.close()
+            returncode = process.wait()
+    finally:
+        os.remove(file_list)
+
+    if returncode != 0:
+        print(f"Error running Cppcheck: exit status {returncode}")
+        return None
+    for path, file_results in results.items():
+        _remember_analysis(keys[path], file_results)
+    return results
@@ -0,0 +1,134 @@
+import time
+import random
+import threading
+
+# Rough Gemini tokenizer ratio for English prose and C source
+CHARS_PER_TOKEN = 4
+
+# Share of the configured quota actually used, leaving headroom for clock skew
+# between our buckets and the provider's accounting
+QUOTA_HEADROOM = 0.95
+
+# After a 429 the allowed rate is multiplied by THROTTLE_FACTOR (never below
+# MIN_RATE_FRACTION of the quota) and then recovers by RECOVERY_STEP of the
+# quota per successful request
+THROTTLE_FACTOR = 0.5
+MIN_RATE_FRACTION = 0.1
+RECOVERY_STEP = 0.05
+
+RETRYABLE_STATUS_CODES = (429, 500, 502, 503, 504)
+
+
+def estimate_tokens(*texts):
+    return sum(len(text) for text in texts) // CHARS_PER_TOKEN + 1
+
+
+class TokenBucket:
+    # Refills continuously at rate_per_minute; the bucket holds at most one
+    # minute's worth so an idle period cannot turn into a burst over quota
+
+    def __init__(self, rate_per_minute):
+        self.quota = rate_per_minute * QUOTA_HEADROOM
+        self.rate = self.quota
+        self.tokens = self.quota
+        self.updated = time.monotonic()
+        self.lock = threading.Lock()
+
+    def _refill(self):
+        now = time.monotonic()
+        self.tokens = min(self.rate, self.tokens + (now - self.updated) * self.rate / 60.0)
+        self.updated = now
+
+    def acquire(self, amount=1):
+        while True:
+            with self.lock:
+                self._refill()
+                # A single request larger than the bucket waits for a full bucket
+                amount = min(amount, self.rate)
+                if self.tokens >= amount:
+                    self.tokens -= amount
+                    return
+                wait = (amount - self.tokens) * 60.0 / self.rate
+            time.sleep(wait)
+
+    def throttle(self):
+        with self.lock:
+            self.rate = max(self.quota * MIN_RATE_FRACTION, self.rate * THROTTLE_FACTOR)
+            self.tokens = min(self.tokens, self.rate)
+
+    def recover(self):
+        with self.lock:
+            self.rate = min(self.quota, self.rate + self.quota * RECOVERY_STEP)
+
+
+class RateLimiter:
+    # Requests/min and tokens/min buckets in front of the LLM stage; either
+    # limit may be None to leave it unenforced
+
+    def __init__(self, requests_per_minute=None, tokens_per_minute=None):
+        self.request_bucket = TokenBucket(requests_per_minute) if requests_per_minute else None
+        self.token_bucket = TokenBucket(tokens_per_minute) if tokens_per_minute else None
+
+    def acquire(self, estimated_tokens):
+        if self.request_bucket:
+            self.request_bucket.acquire(1)
+        if self.token_bucket:
+            self.token_bucket.acquire(estimated_tokens)
+
+    def _each(self):
+        return [bucket for bucket in (self.request_bucket, self.token_bucket) if bucket]
+
+    def on_throttled(self):
+        for bucket in self._each():
+            bucket.throttle()
+
+    def on_success(self):
+        for bucket in self._each():
+            bucket.recover()
+
+
+def _status_code(error):
+    for attribute in ("code", "status_code"):
+        code = getattr(error, attribute, None)
+        if isinstance(code, int):
+            return code
+    response = getattr(error, "response", None)
+    return getattr(response, "status_code", None)
+
+
+def _retry_after(error):
+    response = getattr(error, "response", None)
+    headers = getattr(response, "headers", None) or {}
+    try:
+        return float(headers.get("retry-after"))
+    except (TypeError, ValueError):
+        return None
+
+
+def is_retryable(error):
+    if _status_code(error) in RETRYABLE_STATUS_CODES:
+        return True
+    # Dropped connections and timeouts from the HTTP layer carry no status code
+    return type(error).__name__ in ("ConnectError", "ReadTimeout", "ConnectTimeout", "RemoteProtocolError")
+
+
+def call_with_retries(request, limiter, estimated_tokens, max_attempts=5, base_delay=1.0, max_delay=60.0):
+    # Runs request() under the limiter, retrying throttling and transient
+    # server errors with full-jitter exponential backoff (or the server's
+    # Retry-After when it sends one). Other errors propagate at once.
+    for attempt in range(max_attempts):
+        limiter.acquire(estimated_tokens)
+        try:
+            result = request()
+        except Exception as e:
+            if not is_retryable(e) or attempt == max_attempts - 1:
+                raise
+            if _status_code(e) == 429:
+                limiter.on_throttled()
+            delay = _retry_after(e)
+            if delay is None:
+                delay = random.uniform(0, min(max_delay, base_delay * (2 ** attempt)))
+            time.sleep(delay)
+            continue
+        limiter.on_success()
+        return result
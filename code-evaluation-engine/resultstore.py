@@ -0,0 +1,254 @@
+import json
+import time
+import hashlib
+import sqlite3
+
+# Persistent store of scoring results, one SQLite file across many runs.
+# Every result gets a row in results with the scores in typed columns, and
+# its findings, LLM pillar scores and stage timings go to narrow side tables
+# keyed by result id, so aggregates scan small indexed rows instead of JSON.
+# Rows are written in batches as results arrive; a run's totals are computed
+# once when it finishes and kept on the runs row, so listing runs and score
+# trends never touches the per-file data; the same goes for the per-run
+# finding counts and pillar means.
+
+DEFAULT_BATCH_SIZE = 500
+SCHEMA_VERSION = 1
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS runs (
+    id INTEGER PRIMARY KEY,
+    started REAL NOT NULL,
+    finished REAL,
+    command TEXT,
+    options TEXT,
+    files INTEGER,
+    failed INTEGER,
+    reused INTEGER,
+    mean_final_score REAL,
+    min_final_score REAL,
+    max_final_score REAL
+);
+CREATE TABLE IF NOT EXISTS results (
+    id INTEGER PRIMARY KEY,
+    run_id INTEGER NOT NULL REFERENCES runs (id),
+    path TEXT NOT NULL,
+    file_hash TEXT,                 -- sha256 of the source bytes, when readable
+    static_score REAL,
+    llm_score REAL,
+    final_score REAL,
+    static_weight REAL,
+    llm_weight REAL,
+    provisional INTEGER NOT NULL DEFAULT 0,
+    reused INTEGER NOT NULL DEFAULT 0,
+    error TEXT
+);
+CREATE INDEX IF NOT EXISTS results_run ON results (run_id, final_score);
+CREATE INDEX IF NOT EXISTS results_hash ON results (file_hash);
+CREATE INDEX IF NOT EXISTS results_path ON results (path, run_id);
+CREATE TABLE IF NOT EXISTS findings (
+    result_id INTEGER NOT NULL REFERENCES results (id),
+    run_id INTEGER NOT NULL,        -- copied from results so per-run aggregates need no join
+    severity TEXT NOT NULL,
+    finding_id TEXT NOT NULL,
+    line INTEGER
+);
+CREATE INDEX IF NOT EXISTS findings_run ON findings (run_id, finding_id, severity);
+CREATE INDEX IF NOT EXISTS findings_result ON findings (result_id);
+CREATE TABLE IF NOT EXISTS pillars (
+    result_id INTEGER NOT NULL REFERENCES results (id),
+    run_id INTEGER NOT NULL,
+    pillar TEXT NOT NULL,
+    score REAL
+);
+CREATE INDEX IF NOT EXISTS pillars_run ON pillars (run_id, pillar);
+CREATE INDEX IF NOT EXISTS pillars_result ON pillars (result_id);
+CREATE TABLE IF NOT EXISTS timings (
+    result_id INTEGER NOT NULL REFERENCES results (id),
+    stage TEXT NOT NULL,            -- profiling keys: static_s, llm_s, ..., and token counts
+    value REAL
+);
+CREATE INDEX IF NOT EXISTS timings_result ON timings (result_id);
+-- Per-run totals, filled in when the run finishes
+CREATE TABLE IF NOT EXISTS run_findings (
+    run_id INTEGER NOT NULL REFERENCES runs (id),
+    finding_id TEXT NOT NULL,
+    severity TEXT NOT NULL,
+    count INTEGER,
+    files INTEGER
+);
+CREATE INDEX IF NOT EXISTS run_findings_run ON run_findings (run_id, count);
+CREATE TABLE IF NOT EXISTS run_pillars (
+    run_id INTEGER NOT NULL REFERENCES runs (id),
+    pillar TEXT NOT NULL,
+    mean_score REAL,
+    min_score REAL,
+    files INTEGER
+);
+CREATE INDEX IF NOT EXISTS run_pillars_run ON run_pillars (run_id);
+"""
+
+
+def file_hash(path):
+    sha = hashlib.sha256()
+    try:
+        with open(path, 'rb') as f:
+            for block in iter(lambda: f.read(1 << 20), b''):
+                sha.update(block)
+    except OSError:
+        return None
+    return sha.hexdigest()
+
+
+def connect(path):
+    db = sqlite3.connect(path)
+    db.execute("PRAGMA journal_mode=WAL")
+    version = db.execute("PRAGMA user_version").fetchone()[0]
+    if version == 0:
+        db.executescript(_SCHEMA)
+        db.execute(f"PRAGMA user_version = {SCHEMA_VERSION}")
+    elif version != SCHEMA_VERSION:
+        db.close()
+        raise ValueError(f"{path} has result store schema {version}, expected {SCHEMA_VERSION}")
+    return db
+
+
+class ResultStore:
+    # Writer for one run. add() buffers at most batch_size results before
+    # writing them in one transaction, so memory stays flat however many
+    # files the run covers.
+
+    def __init__(self, path, command=None, options=None, batch_size=DEFAULT_BATCH_SIZE):
+        self._db = connect(path)
+        self.batch_size = batch_size
+        self._pending = []
+        with self._db:
+            self.run_id = self._db.execute("INSERT INTO runs (started, command, options) VALUES (?, ?, ?)",
+                                           (time.time(), command, json.dumps(options, sort_keys=True))).lastrowid
+
+    def add(self, result):
+        self._pending.append(result)
+        if len(self._pending) >= self.batch_size:
+            self.flush()
+
+    def _insert(self, result):
+        path = result.get("file", "")
+        row = (self.run_id, path, file_hash(path), result.get("static_score"), result.get("llm_score"),
+               result.get("final_score"), result.get("static_weight"), result.get("llm_weight"),
+               int(bool(result.get("provisional"))), int(bool(result.get("reused"))), result.get("error"))
+        result_id = self._db.execute(
+            "INSERT INTO results (run_id, path, file_hash, static_score, llm_score, final_score, static_weight, "
+            "llm_weight, provisional, reused, error) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)", row).lastrowid
+        self._db.executemany("INSERT INTO findings (result_id, run_id, severity, finding_id, line) "
+                             "VALUES (?, ?, ?, ?, ?)",
+                             ((result_id, self.run_id, severity, finding_id, line)
+                              for severity, finding_id, line in result.get("static_findings", [])))
+        self._db.executemany("INSERT INTO pillars (result_id, run_id, pillar, score) VALUES (?, ?, ?, ?)",
+                             ((result_id, self.run_id, pillar, score)
+                              for pillar, score in result.get("llm_pillars", {}).items()))
+        self._db.executemany("INSERT INTO timings (result_id, stage, value) VALUES (?, ?, ?)",
+                             ((result_id, stage, value) for stage, value in result.get("profile", {}).items()
+                              if isinstance(value, (int, float))))
+
+    def flush(self):
+        if not self._pending:
+            return
+        with self._db:
+            for result in self._pending:
+                self._insert(result)
+        self._pending = []
+
+    def close(self):
+        # Writes what is left and the run's totals
+        self.flush()
+        with self._db:
+            self._db.execute(
+                "UPDATE runs SET finished = ?, (files, failed, reused, mean_final_score, min_final_score, "
+                "max_final_score) = (SELECT COUNT(*), SUM(error IS NOT NULL), SUM(reused), AVG(final_score), "
+                "MIN(final_score), MAX(final_score) FROM results WHERE run_id = ?) WHERE id = ?",
+                (time.time(), self.run_id, self.run_id))
+            self._db.execute("INSERT INTO run_findings (run_id, finding_id, severity, count, files) "
+                             "SELECT run_id, " + _FINDING_TOTALS + " GROUP BY finding_id, severity", (self.run_id,))
+            self._db.execute("INSERT INTO run_pillars (run_id, pillar, mean_score, min_score, files) "
+                             "SELECT run_id, " + _PILLAR_TOTALS + " GROUP BY pillar", (self.run_id,))
+        self._db.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
+        return False
+
+
+_FINDING_TOTALS = ("finding_id, severity, COUNT(*) AS count, COUNT(DISTINCT result_id) AS files "
+                   "FROM findings WHERE run_id = ?")
+_PILLAR_TOTALS = "pillar, AVG(score) AS mean_score, MIN(score) AS min_score, COUNT(*) AS files FROM pillars WHERE run_id = ?"
+
+
+def _finished(db, run_id):
+    row = db.execute("SELECT finished FROM runs WHERE id = ?", (run_id,)).fetchone()
+    return row is not None and row[0] is not None
+
+
+def _rows(db, query, params=()):
+    cursor = db.execute(query, params)
+    columns = [column[0] for column in cursor.description]
+    return [dict(zip(columns, row)) for row in cursor.fetchall()]
+
+
+def latest_run(db):
+    row = db.execute("SELECT MAX(id) FROM runs").fetchone()
+    return row[0]
+
+
+def list_runs(db, limit=20):
+    # Newest first, with the totals stored when each run finished; doubles as
+    # the score trend across runs
+    return _rows(db, "SELECT id, started, finished, command, files, failed, reused, mean_final_score, "
+                     "min_final_score, max_final_score FROM runs ORDER BY id DESC LIMIT ?", (limit,))
+
+
+def run_findings(db, run_id, limit=20):
+    # Most frequent findings of a run and how many files have each. A run
+    # still in progress (or one that crashed) is aggregated on the fly.
+    if _finished(db, run_id):
+        return _rows(db, "SELECT finding_id, severity, count, files FROM run_findings WHERE run_id = ? "
+                         "ORDER BY count DESC LIMIT ?", (run_id, limit))
+    return _rows(db, "SELECT " + _FINDING_TOTALS + " GROUP BY finding_id, severity ORDER BY count DESC LIMIT ?",
+                 (run_id, limit))
+
+
+def run_pillars(db, run_id):
+    if _finished(db, run_id):
+        return _rows(db, "SELECT pillar, mean_score, min_score, files FROM run_pillars WHERE run_id = ? "
+                         "ORDER BY pillar", (run_id,))
+    return _rows(db, "SELECT " + _PILLAR_TOTALS + " GROUP BY pillar ORDER BY pillar", (run_id,))
+
+
+def run_timings(db, run_id):
+    return _rows(db, "SELECT stage, COUNT(*) AS count, AVG(value) AS mean, MAX(value) AS max "
+                     "FROM timings JOIN results ON results.id = timings.result_id WHERE results.run_id = ? "
+                     "GROUP BY stage ORDER BY stage", (run_id,))
+
+
+def lowest_scores(db, run_id, limit=20):
+    return _rows(db, "SELECT path, file_hash, static_score, llm_score, final_score FROM results "
+                     "WHERE run_id = ? AND final_score IS NOT NULL ORDER BY final_score LIMIT ?", (run_id, limit))
+
+
+def file_history(db, path=None, digest=None):
+    # Scores of one file over all runs, by path or by content hash
+    column, value = ("file_hash", digest) if digest else ("path", path)
+    return _rows(db, f"SELECT results.run_id, runs.started, path, file_hash, static_score, llm_score, final_score, "
+                     f"error FROM results JOIN runs ON runs.id = results.run_id WHERE {column} = ? "
+                     f"ORDER BY results.run_id", (value,))
+
+
+def score_changes(db, run_id, base_run_id, limit=20):
+    # Files whose final score moved the most between two runs, matched by path
+    return _rows(db, "SELECT new.path, old.final_score AS base_score, new.final_score AS score, "
+                     "new.final_score - old.final_score AS change FROM results AS new "
+                     "JOIN results AS old ON old.path = new.path AND old.run_id = ? "
+                     "WHERE new.run_id = ? AND new.final_score IS NOT NULL AND old.final_score IS NOT NULL "
+                     "ORDER BY ABS(new.final_score - old.final_score) DESC LIMIT ?", (base_run_id, run_id, limit))
@@ -0,0 +1,183 @@
+import json
+import time
+import uuid
+import sqlite3
+import threading
+
+# Durable queue of files to analyze, kept in one SQLite database so a
+# coordinator that is restarted picks up where it stopped. A task is leased
+# to one worker at a time; a lease that is neither completed nor renewed
+# before it expires makes the task available again, so a crashed worker
+# costs one lease period rather than the file. Every lease counts as an
+# attempt and a task that used up max_attempts is marked failed.
+
+DEFAULT_LEASE_SECONDS = 300
+DEFAULT_MAX_ATTEMPTS = 3
+
+_SCHEMA = """
+CREATE TABLE IF NOT EXISTS tasks (
+    id INTEGER PRIMARY KEY,
+    path TEXT NOT NULL UNIQUE,
+    state TEXT NOT NULL DEFAULT 'pending',  -- pending, leased, done, failed
+    attempts INTEGER NOT NULL DEFAULT 0,
+    worker TEXT,
+    token TEXT,
+    lease_expires REAL,
+    result TEXT,
+    final_score REAL,
+    reused INTEGER NOT NULL DEFAULT 0,
+    finished INTEGER,                       -- completion order, for streaming results out
+    result_key TEXT                         -- cache key of the content last leased out
+);
+CREATE INDEX IF NOT EXISTS tasks_state ON tasks (state, lease_expires);
+CREATE INDEX IF NOT EXISTS tasks_finished ON tasks (finished);
+"""
+
+
+class TaskQueue:
+    def __init__(self, path, max_attempts=DEFAULT_MAX_ATTEMPTS):
+        self.max_attempts = max_attempts
+        # One connection shared by the coordinator's request threads; the lock
+        # serializes them, which SQLite would do anyway
+        self._db = sqlite3.connect(path, check_same_thread=False)
+        self._db.execute("PRAGMA journal_mode=WAL")
+        self._db.executescript(_SCHEMA)
+        columns = [row[1] for row in self._db.execute("PRAGMA table_info(tasks)")]
+        if "result_key" not in columns:
+            # Queues written before result keys were kept
+            self._db.execute("ALTER TABLE tasks ADD COLUMN result_key TEXT")
+        self._lock = threading.Lock()
+
+    def close(self):
+        self._db.close()
+
+    def enqueue(self, sources):
+        # Files already in the queue keep their state, so re-running the
+        # coordinator over the same corpus resumes it. Returns the number added.
+        with self._lock, self._db:
+            before = self._db.total_changes
+            self._db.executemany("INSERT OR IGNORE INTO tasks (path) VALUES (?)", ((source,) for source in sources))
+            return self._db.total_changes - before
+
+    def _finish_failed(self, task_id, path, error):
+        self._db.execute("UPDATE tasks SET state = 'failed', token = NULL, result = ?, "
+                         "finished = (SELECT COALESCE(MAX(finished), 0) + 1 FROM tasks) WHERE id = ?",
+                         (json.dumps({"file": path, "error": error}), task_id))
+
+    def _expire_leases(self, now):
+        exhausted = self._db.execute("SELECT id, path, attempts FROM tasks WHERE state = 'leased' "
+                                     "AND lease_expires < ? AND attempts >= ?", (now, self.max_attempts)).fetchall()
+        for task_id, path, attempts in exhausted:
+            self._finish_failed(task_id, path, f"lease expired {attempts} times")
+        self._db.execute("UPDATE tasks SET state = 'pending', worker = NULL, token = NULL "
+                         "WHERE state = 'leased' AND lease_expires < ?", (now,))
+
+    def lease(self, worker, lease_seconds=DEFAULT_LEASE_SECONDS):
+        # The oldest available task as {"id", "path", "token", "attempts"}, or None
+        now = time.time()
+        with self._lock, self._db:
+            self._expire_leases(now)
+            row = self._db.execute("SELECT id, path, attempts FROM tasks WHERE state = 'pending' "
+                                   "ORDER BY id LIMIT 1").fetchone()
+            if row is None:
+                return None
+            token = uuid.uuid4().hex
+            self._db.execute("UPDATE tasks SET state = 'leased', attempts = attempts + 1, worker = ?, token = ?, "
+                             "lease_expires = ? WHERE id = ?", (worker, token, now + lease_seconds, row[0]))
+            return {"id": row[0], "path": row[1], "token": token, "attempts": row[2] + 1}
+
+    def renew(self, task_id, token, lease_seconds=DEFAULT_LEASE_SECONDS):
+        # False once the lease has been lost to expiry; the worker should drop the task
+        with self._lock, self._db:
+            cursor = self._db.execute("UPDATE tasks SET lease_expires = ? WHERE id = ? AND token = ? "
+                                      "AND state = 'leased'", (time.time() + lease_seconds, task_id, token))
+            return cursor.rowcount == 1
+
+    def set_result_key(self, task_id, token, result_key):
+        # Records the cache key of what this lease handed out, for storing its result
+        with self._lock, self._db:
+            cursor = self._db.execute("UPDATE tasks SET result_key = ? WHERE id = ? AND token = ? AND state = 'leased'",
+                                      (result_key, task_id, token))
+            return cursor.rowcount == 1
+
+    def complete(self, task_id, token, result, reused=False):
+        # Only the current lease holder can complete a task, so a worker that
+        # comes back after its lease was handed on cannot record a second result
+        with self._lock, self._db:
+            cursor = self._db.execute(
+                "UPDATE tasks SET state = ?, result = ?, final_score = ?, reused = ?, token = NULL, "
+                "finished = (SELECT COALESCE(MAX(finished), 0) + 1 FROM tasks) "
+                "WHERE id = ? AND token = ? AND state = 'leased'",
+                ("failed" if "error" in result else "done", json.dumps(result), result.get("final_score"),
+                 int(reused), task_id, token))
+            return cursor.rowcount == 1
+
+    def pending(self, after_id=0, limit=500):
+        # (id, path) of pending tasks after after_id, one page at a time
+        with self._lock:
+            return self._db.execute("SELECT id, path FROM tasks WHERE state = 'pending' AND id > ? "
+                                    "ORDER BY id LIMIT ?", (after_id, limit)).fetchall()
+
+    def reuse(self, task_id, result):
+        # Completes a pending task with a stored result, without a lease
+        with self._lock, self._db:
+            cursor = self._db.execute(
+                "UPDATE tasks SET state = 'done', result = ?, final_score = ?, reused = 1, "
+                "finished = (SELECT COALESCE(MAX(finished), 0) + 1 FROM tasks) WHERE id = ? AND state = 'pending'",
+                (json.dumps(result), result.get("final_score"), task_id))
+            return cursor.rowcount == 1
+
+    def fail(self, task_id, token, error):
+        # Puts the task back for another worker, or fails it for good once
+        # it has used up its attempts
+        with self._lock, self._db:
+            row = self._db.execute("SELECT path, attempts FROM tasks WHERE id = ? AND token = ? AND state = 'leased'",
+                                   (task_id, token)).fetchone()
+            if row is None:
+                return False
+            if row[1] < self.max_attempts:
+                self._db.execute("UPDATE tasks SET state = 'pending', worker = NULL, token = NULL WHERE id = ?",
+                                 (task_id,))
+            else:
+                self._finish_failed(task_id, row[0], error)
+            return True
+
+    def results_since(self, cursor, limit=500):
+        # (new cursor, [(result, result_key)]) for tasks finished after cursor,
+        # oldest first; read in pages so a large corpus is never held in memory
+        # at once. result_key is None for results that were never leased.
+        with self._lock:
+            rows = self._db.execute("SELECT finished, result, reused, result_key FROM tasks WHERE finished > ? "
+                                    "ORDER BY finished LIMIT ?", (cursor, limit)).fetchall()
+        results = []
+        for finished, result, reused, result_key in rows:
+            result = json.loads(result)
+            if reused:
+                result["reused"] = True
+            results.append((result, result_key))
+            cursor = finished
+        return cursor, results
+
+    def counts(self):
+        with self._lock:
+            rows = self._db.execute("SELECT state, COUNT(*) FROM tasks GROUP BY state").fetchall()
+        counts = {"pending": 0, "leased": 0, "done": 0, "failed": 0}
+        counts.update(dict(rows))
+        return counts
+
+    def remaining(self):
+        counts = self.counts()
+        return counts["pending"] + counts["leased"]
+
+    def summary(self):
+        # Same fields as script.summarize_results, computed in SQL
+        with self._lock:
+            files, failed, reused, mean, low, high = self._db.execute(
+                "SELECT COUNT(*), SUM(state = 'failed'), SUM(reused), AVG(final_score), MIN(final_score), "
+                "MAX(final_score) FROM tasks WHERE state IN ('done', 'failed')").fetchone()
+        summary = {"files": files, "failed": failed or 0, "reanalyzed": files - (reused or 0), "reused": reused or 0}
+        if mean is not None:
+            summary["mean_final_score"] = mean
+            summary["min_final_score"] = low
+            summary["max_final_score"] = high
+        return summary
@@ -4,18 +4,20 @@ import os
 # Add the code-evaluation-engine directory to path
 sys.path.append(os.path.join(os.path.dirname(__file__), '..', 'code-evaluation-engine'))
 
-from qualitative import run_qualitative_analysis
+from qualitative import run_structured_qualitative_analysis, parse_structured_verdict
 
 def main():
     # Path to the C file to analyze (relative to this script)
     source_file = os.path.join(os.path.dirname(__file__), '..', 'code-evaluation-engine', 'bad_driver.c')
     source_file = os.path.abspath(source_file)
+    prompt_file = os.path.join(os.path.dirname(__file__), '..', 'code-evaluation-engine', 'prompt.txt')
     
     if len(sys.argv) > 1:
         source_file = os.path.abspath(sys.argv[1])
     
-    # Run qualitative analysis
-    result = run_qualitative_analysis(source_file)
+    # Run qualitative analysis; only the numbers are needed here
+    response_text = run_structured_qualitative_analysis(source_file, prompt_file, include_rationale=False)
+    result = parse_structured_verdict(response_text)
     
     if "error" in result:
         print(f"Error: {result['error']}")
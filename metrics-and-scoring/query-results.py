@@ -0,0 +1,61 @@
+import sys
+import os
+import json
+import argparse
+
+# Add the code-evaluation-engine directory to path
+sys.path.append(os.path.join(os.path.dirname(__file__), '..', 'code-evaluation-engine'))
+
+import resultstore
+
+# Reports over a store written by script.py --results-db. Queries default to
+# the latest run; every report is printed as JSON lines.
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Query a result store written by script.py --results-db.")
+    parser.add_argument("db", help="SQLite result store")
+    parser.add_argument("report", choices=["runs", "findings", "pillars", "timings", "lowest", "history", "changes"],
+                        help="runs: totals per run (the score trend); findings, pillars, timings, lowest: one run; "
+                             "history: one file across runs; changes: largest score moves since --base")
+    parser.add_argument("--run", type=int, default=None, help="run id (default: latest)")
+    parser.add_argument("--base", type=int, default=None, help="with changes, run to compare against (default: previous)")
+    parser.add_argument("--file", default=None, help="with history, source path")
+    parser.add_argument("--hash", default=None, help="with history, sha256 of the source instead of a path")
+    parser.add_argument("--limit", type=int, default=20)
+    args = parser.parse_args()
+
+    if not os.path.exists(args.db):
+        print(f"File not found: {args.db}")
+        sys.exit(1)
+    db = resultstore.connect(args.db)
+    run_id = args.run or resultstore.latest_run(db)
+
+    if args.report == "runs":
+        rows = resultstore.list_runs(db, args.limit)
+    elif args.report == "history":
+        if not args.file and not args.hash:
+            print("history needs --file or --hash")
+            sys.exit(1)
+        rows = resultstore.file_history(db, os.path.abspath(args.file) if args.file else None, args.hash)
+    elif run_id is None:
+        print("The store has no runs yet.")
+        sys.exit(1)
+    elif args.report == "findings":
+        rows = resultstore.run_findings(db, run_id, args.limit)
+    elif args.report == "pillars":
+        rows = resultstore.run_pillars(db, run_id)
+    elif args.report == "timings":
+        rows = resultstore.run_timings(db, run_id)
+    elif args.report == "lowest":
+        rows = resultstore.lowest_scores(db, run_id, args.limit)
+    else:
+        base = args.base or run_id - 1
+        rows = resultstore.score_changes(db, run_id, base, args.limit)
+
+    for row in rows:
+        print(json.dumps(row))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,75 +1,1015 @@
 import sys
 import os
+import json
+import time
+import atexit
+import socket
+import argparse
+import tempfile
+import subprocess
+import contextlib
+from concurrent.futures import ProcessPoolExecutor, ThreadPoolExecutor, as_completed
 
-sys.path.append('code-evaluation-engine')
-from quantitative import run_cppcheck
-from qualitative import run_qualitative_analysis, parse_qualitative_score
-
-def parse_quantitative_score(cppcheck_results):
-    severity_weights = {
-        'error': 10,
-        'warning': 5,
-        'style': 2,
-        'performance': 3,
-        'portability': 2,
-        'information': 1
-    }
-    
-    total_penalty = 0
-    
-    if not cppcheck_results or 'errors' not in cppcheck_results:
-        return 100
-    
-    for error in cppcheck_results['errors']:
-        severity = error.get('severity', 'unknown')
-        
-        if error.get('id') in ['checkersReport', 'missingIncludeSystem']:
-            continue
-            
-        weight = severity_weights.get(severity, 1)
-        total_penalty += weight
-    
-    return max(0, 100 - total_penalty)
+ENGINE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'code-evaluation-engine')
+PROMPT_PATH = os.path.join(ENGINE_DIR, 'prompt.txt')
 
+sys.path.append(ENGINE_DIR)
+from quantitative import (run_cppcheck, run_cppcheck_many, analyze_source, score_cppcheck_results,
+                          penalties_by_severity, finding_rows, configure_cppcheck, cppcheck_settings, restore_cppcheck_settings, CHECK_PROFILES,
+                          has_whole_program_checks)
+from qualitative import (run_qualitative_analysis, stream_qualitative_analysis, parse_qualitative_score, MODEL_NAME,
+                         configure_client, DEFAULT_MAX_IN_FLIGHT,
+                         run_structured_qualitative_analysis, parse_structured_verdict,
+                         run_structured_chunk_analysis, PILLAR_WEIGHTS,
+                         run_batched_qualitative_analysis, parse_batch_scores,
+                         submit_batch_job, wait_for_batch_job)
+from cache import cppcheck_cache_key, llm_cache_key, chunk_cache_key, result_cache_key, load_cached, store_cached
+from chunking import split_source
+from perfcheck import with_native_findings, configure_benchmarks, benchmark_settings, restore_benchmark_settings
+from incremental import changed_files
+from resultstore import ResultStore
+from taskqueue import TaskQueue, DEFAULT_LEASE_SECONDS, DEFAULT_MAX_ATTEMPTS
+import dispatch
+import profiling
 
+SOURCE_EXTENSIONS = ('.c', '.h')
+# LLM requests in flight per worker while a multi-file cppcheck run is going
+CHUNK_LLM_THREADS = 4
+# Options that select how a file is judged, as passed to run_llm_stage
+LLM_OPTION_KEYS = ("cache_dir", "stream", "stop_on_score", "structured", "include_rationale", "chunk_lines")
+# Options the coordinator sends with every task so all nodes judge alike;
+# the static-stage settings go along too (see _task_settings()), caches and
+# the cppcheck build dir stay node-local
+TASK_OPTION_KEYS = ("concurrent", "profile", "triage_below", "triage_above", "stream", "stop_on_score", "structured",
+                    "include_rationale", "chunk_lines")
+DEFAULT_LISTEN = "127.0.0.1:8765"
+# Cache variant of verdicts from packed requests
+PACKED_VARIANT = "batch"
+# How long a finished coordinator keeps answering so polling workers hear it is done
+COORDINATOR_GRACE_SECONDS = 3
 
-def analyze_code(source_file):
-    # Convert to absolute path if relative
-    if not os.path.isabs(source_file):
-        source_file = os.path.abspath(source_file)
-    
-    quantitative_results = run_cppcheck(source_file)
-    qualitative_results = run_qualitative_analysis(source_file, "code-evaluation-engine/prompt.txt")
-    
-    quant_score = parse_quantitative_score(quantitative_results)
-    print("Static analysis score (deterministic): ", quant_score)
-    qual_score = parse_qualitative_score(qualitative_results)
-    print("LLM-as-a-judge analysis (heuristic): ", qual_score)
+def combine_scores(quant_score, qual_score):
     score_diff = abs(quant_score - qual_score)
     if score_diff > 30:
         # Large difference, trust LLM more
-        final_score = (quant_score * 0.2) + (qual_score * 0.8)
-        print("Weighting: 20% static analysis, 80% LLM (diff > 30)")
+        static_weight, llm_weight = 0.2, 0.8
     else:
         # Smaller difference, trust LLM but static a bit more
-        final_score = (quant_score * 0.3) + (qual_score * 0.7)
-        print("Weighting: 30% static analysis, 70% LLM (diff <= 30)")
-    return final_score
+        static_weight, llm_weight = 0.3, 0.7
+    final_score = (quant_score * static_weight) + (qual_score * llm_weight)
+    return final_score, static_weight, llm_weight
+
+
+def is_decisive(static_results, triage_below=None, triage_above=None):
+    # Static scores beyond either threshold settle the outcome on their own.
+    # A failed cppcheck run (None) would score 100, so it never does.
+    if static_results is None:
+        return False
+    quant_score = score_cppcheck_results(static_results)
+    if triage_below is not None and quant_score < triage_below:
+        return True
+    return triage_above is not None and quant_score > triage_above
+
+
+def run_static_stage(source_file, output_xml=None, cache_dir=None):
+    # cppcheck findings (cached) plus the native performance checks, which are
+    # cheap enough to rerun every time
+    with profiling.timed("static_s"):
+        return with_native_findings(source_file, _run_static_stage(source_file, output_xml, cache_dir))
+
+
+def _run_static_stage(source_file, output_xml=None, cache_dir=None):
+    if cache_dir:
+        key = cppcheck_cache_key(source_file)
+        cached = load_cached(cache_dir, "cppcheck", key)
+        if cached is not None:
+            return cached
+
+    with profiling.timed("cppcheck_s"):
+        if output_xml is None:
+            quantitative_results = analyze_source(source_file)
+        else:
+            quantitative_results = run_cppcheck(source_file, output_xml=output_xml)
+    # Failed runs return None and are retried next time rather than cached
+    if cache_dir and quantitative_results is not None:
+        store_cached(cache_dir, "cppcheck", key, quantitative_results)
+    return quantitative_results
+
+
+def run_static_stage_many(source_files, cache_dir=None, jobs=None):
+    with profiling.timed("static_s"):
+        results = _run_static_stage_many(source_files, cache_dir, jobs)
+        return {source_file: with_native_findings(source_file, file_results)
+                for source_file, file_results in results.items()}
+
+
+def _run_static_stage_many(source_files, cache_dir=None, jobs=None):
+    results = {}
+    keys = {}
+    pending = []
+    for source_file in source_files:
+        if cache_dir:
+            keys[source_file] = cppcheck_cache_key(source_file)
+            cached = load_cached(cache_dir, "cppcheck", keys[source_file])
+            if cached is not None:
+                results[source_file] = cached
+                continue
+        pending.append(source_file)
+
+    if pending:
+        with profiling.timed("cppcheck_s"):
+            batch_results = run_cppcheck_many(pending, jobs=jobs) or {}
+        for source_file in pending:
+            file_results = batch_results.get(source_file)
+            results[source_file] = file_results
+            if cache_dir and file_results is not None:
+                store_cached(cache_dir, "cppcheck", keys[source_file], file_results)
+    return results
+
+
+def llm_variant(structured=False, include_rationale=True, chunk_lines=None, stop_on_score=False, **_):
+    # Cache variant for the judging mode; free-text and streamed judging send the
+    # same request, --stop-on-score asks for the score first
+    variant = None
+    if structured:
+        variant = "structured" if include_rationale else "structured-scores-only"
+    elif stop_on_score:
+        variant = "score-first"
+    if chunk_lines:
+        variant = f"{variant or 'free-text'}-chunked-{chunk_lines}"
+    return variant
+
+
+def result_variant(llm_batch=0, **options):
+    # Cache variant of whole results; packed judging (--llm-batch, the batch
+    # API) uses its own rubric and sees other files alongside each one
+    return PACKED_VARIANT if llm_batch > 0 else llm_variant(**options)
+
+
+def _llm_options(options):
+    return {key: options[key] for key in LLM_OPTION_KEYS if key in options}
+
+
+def run_llm_stage(source_file, cache_dir=None, stream=False, stop_on_score=False,
+                  structured=False, include_rationale=True, chunk_lines=None):
+    # Returns the verdict {"score": 0-100}, plus per-pillar scores when structured
+    # or chunked. Files longer than chunk_lines are judged function by function.
+    with profiling.timed("llm_s"):
+        return _run_llm_stage(source_file, cache_dir, stream, stop_on_score, structured, include_rationale,
+                              chunk_lines)
+
+
+def _run_llm_stage(source_file, cache_dir=None, stream=False, stop_on_score=False,
+                   structured=False, include_rationale=True, chunk_lines=None):
+    if cache_dir:
+        key = llm_cache_key(source_file, PROMPT_PATH, MODEL_NAME,
+                            llm_variant(structured, include_rationale, chunk_lines, stop_on_score))
+        cached = load_cached(cache_dir, "llm", key)
+        if cached is not None:
+            return cached
+
+    # Short files, and files where no unit could be judged, are judged whole
+    verdict = run_chunked_llm_stage(source_file, cache_dir, include_rationale, chunk_lines) if chunk_lines else None
+    if verdict is None:
+        verdict = _judge_file(source_file, stream, stop_on_score, structured, include_rationale)
+    if cache_dir:
+        store_cached(cache_dir, "llm", key, verdict)
+    return verdict
+
+
+def _judge_file(source_file, stream=False, stop_on_score=False, structured=False, include_rationale=True):
+    if structured:
+        qualitative_results = run_structured_qualitative_analysis(source_file, PROMPT_PATH, include_rationale)
+        parsed = parse_structured_verdict(qualitative_results)
+        if "error" in parsed:
+            print(f"Structured verdict rejected for {source_file}: {parsed['error']}")
+            return {"score": parse_qualitative_score(qualitative_results)}
+        return {"score": parsed["overall_score"], "pillars": parsed["pillars"]}
+    if stream:
+        qualitative_results = stream_qualitative_analysis(source_file, PROMPT_PATH, stop_on_score)
+    else:
+        qualitative_results = run_qualitative_analysis(source_file, PROMPT_PATH)
+    return {"score": parse_qualitative_score(qualitative_results)}
+
+
+def _judge_unit(context, unit, cache_dir=None, include_rationale=True):
+    # Structured verdict {"score", "pillars"} for one unit, or None when rejected
+    variant = None if include_rationale else "scores-only"
+    if cache_dir:
+        key = chunk_cache_key(unit["text"], context, PROMPT_PATH, MODEL_NAME, variant)
+        cached = load_cached(cache_dir, "llm-chunk", key)
+        if cached is not None:
+            return cached
+
+    parsed = parse_structured_verdict(run_structured_chunk_analysis(context, unit, PROMPT_PATH, include_rationale))
+    if "error" in parsed:
+        print(f"Structured verdict rejected for unit {unit['name']}: {parsed['error']}")
+        return None
+    verdict = {"score": parsed["overall_score"], "pillars": parsed["pillars"]}
+    if cache_dir:
+        store_cached(cache_dir, "llm-chunk", key, verdict)
+    return verdict
+
+
+def run_chunked_llm_stage(source_file, cache_dir=None, include_rationale=True, chunk_lines=None):
+    # Splits a file longer than chunk_lines into handler-aligned units, judges
+    # them concurrently and combines their pillar scores weighted by each
+    # unit's line count. Returns None when the file is short enough to judge whole.
+    with open(source_file, 'r') as f:
+        source_code = f.read()
+    if source_code.count('\n') + 1 <= chunk_lines:
+        return None
+    context, units = split_source(source_code, chunk_lines)
+    if not units:
+        return None
+
+    with ThreadPoolExecutor(max_workers=CHUNK_LLM_THREADS) as judges:
+        judge = profiling.bound(profiling.current(), _judge_unit)
+        unit_verdicts = list(judges.map(lambda unit: judge(context, unit, cache_dir, include_rationale), units))
+
+    judged = [(unit, verdict) for unit, verdict in zip(units, unit_verdicts) if verdict is not None]
+    if not judged:
+        return None
+    total_lines = sum(unit["lines"] for unit, _ in judged)
+    pillars = {pillar: round(sum(verdict["pillars"][pillar] * unit["lines"] for unit, verdict in judged) / total_lines, 4)
+               for pillar in PILLAR_WEIGHTS}
+    score = round(sum(pillars[pillar] * weight for pillar, weight in PILLAR_WEIGHTS.items()), 2)
+    return {"score": score, "pillars": pillars,
+            "chunks": [{"name": unit["name"], "lines": unit["lines"], "score": verdict["score"]}
+                       for unit, verdict in judged]}
+
+
+def run_llm_stage_group(source_files, cache_dir=None):
+    # Judges a group of files in one packed request; files the judge skipped
+    # or scored unusably are re-judged on their own
+    verdicts = {}
+    keys = {}
+    pending = []
+    for source_file in source_files:
+        if cache_dir:
+            keys[source_file] = llm_cache_key(source_file, PROMPT_PATH, MODEL_NAME, PACKED_VARIANT)
+            cached = load_cached(cache_dir, "llm", keys[source_file])
+            if cached is not None:
+                verdicts[source_file] = cached
+                continue
+        pending.append(source_file)
+
+    if len(pending) > 1:
+        batch_scores = parse_batch_scores(run_batched_qualitative_analysis(pending, PROMPT_PATH), len(pending))
+        for source_file, score in zip(pending, batch_scores):
+            if score is not None:
+                verdicts[source_file] = {"score": score}
+                if cache_dir:
+                    store_cached(cache_dir, "llm", keys[source_file], verdicts[source_file])
+
+    for source_file in pending:
+        if source_file not in verdicts:
+            verdicts[source_file] = run_llm_stage(source_file, cache_dir)
+    return [verdicts[source_file] for source_file in source_files]
+
+
+def evaluate_file(source_file, output_xml=None, concurrent=True, cache_dir=None, profile=False,
+                  triage_below=None, triage_above=None, **llm_options):
+    # Convert to absolute path if relative
+    if not os.path.isabs(source_file):
+        source_file = os.path.abspath(source_file)
+
+    timings = {}
+    with profiling.collecting(timings), profiling.timed("total_s"):
+        if triage_below is not None or triage_above is not None:
+            # Triage needs the static score before deciding whether to pay for the LLM
+            quantitative_results = run_static_stage(source_file, output_xml, cache_dir)
+            if is_decisive(quantitative_results, triage_below, triage_above):
+                verdict = None
+            else:
+                verdict = run_llm_stage(source_file, cache_dir, **llm_options)
+        elif concurrent:
+            # The cppcheck subprocess and the Gemini round-trip are independent and
+            # both wait on I/O, so overlap them and join before weighting
+            with ThreadPoolExecutor(max_workers=2) as stages:
+                static_future = stages.submit(profiling.bound(timings, run_static_stage),
+                                              source_file, output_xml, cache_dir)
+                llm_future = stages.submit(profiling.bound(timings, run_llm_stage),
+                                           source_file, cache_dir, **llm_options)
+                quantitative_results = static_future.result()
+                verdict = llm_future.result()
+        else:
+            quantitative_results = run_static_stage(source_file, output_xml, cache_dir)
+            verdict = run_llm_stage(source_file, cache_dir, **llm_options)
+
+    result = score_results(source_file, quantitative_results, verdict)
+    if profile:
+        result["profile"] = timings
+    return result
+
+
+def score_results(source_file, quantitative_results, verdict):
+    # A verdict of None means triage skipped the LLM: the static score stands as a provisional result
+    quant_score = score_cppcheck_results(quantitative_results)
+    penalties = penalties_by_severity(quantitative_results)
+    # Kept for --results-db; _emit() leaves them out of the JSON lines
+    findings = finding_rows(quantitative_results)
+    if verdict is None:
+        return {
+            "file": source_file,
+            "static_score": quant_score,
+            "static_penalties": penalties,
+            "static_findings": findings,
+            "llm_score": None,
+            "static_weight": 1.0,
+            "llm_weight": 0.0,
+            "final_score": quant_score,
+            "provisional": True
+        }
+    qual_score = verdict["score"]
+    final_score, static_weight, llm_weight = combine_scores(quant_score, qual_score)
+    result = {
+        "file": source_file,
+        "static_score": quant_score,
+        "static_penalties": penalties,
+        "static_findings": findings,
+        "llm_score": qual_score,
+        "static_weight": static_weight,
+        "llm_weight": llm_weight,
+        "final_score": final_score
+    }
+    if "pillars" in verdict:
+        result["llm_pillars"] = verdict["pillars"]
+    if "chunks" in verdict:
+        result["llm_chunks"] = verdict["chunks"]
+    return result
+
+
+def analyze_code(source_file, store=None, **options):
+    result = evaluate_file(source_file, **options)
+    if store:
+        store.add(result)
+
+    print("Static analysis score (deterministic): ", result["static_score"])
+    penalties = result.get("static_penalties", {})
+    if penalties:
+        print("  Penalties: " + ", ".join(f"{severity} {penalty}" for severity, penalty in sorted(penalties.items())))
+    if result.get("provisional"):
+        print("LLM-as-a-judge analysis (heuristic): skipped, static score is decisive")
+        print("Weighting: 100% static analysis (provisional)")
+    else:
+        print("LLM-as-a-judge analysis (heuristic): ", result["llm_score"])
+        for pillar, pillar_score in result.get("llm_pillars", {}).items():
+            print(f"  {pillar}: {pillar_score}")
+        for chunk in result.get("llm_chunks", []):
+            print(f"  [{chunk['name']}] {chunk['lines']} lines: {chunk['score']}")
+        if result["static_weight"] == 0.2:
+            print("Weighting: 20% static analysis, 80% LLM (diff > 30)")
+        else:
+            print("Weighting: 30% static analysis, 70% LLM (diff <= 30)")
+    if "profile" in result:
+        print(profiling.format_table(profiling.summarize([result["profile"]])))
+    return result["final_score"]
+
+
+def collect_sources(target):
+    # A directory is scanned recursively; anything else is read as a manifest
+    # with one path per line, or JSON lines carrying a "path"/"file"/"source_file" key.
+    if os.path.isdir(target):
+        sources = []
+        for root, _, files in os.walk(target):
+            for name in files:
+                if name.endswith(SOURCE_EXTENSIONS):
+                    sources.append(os.path.abspath(os.path.join(root, name)))
+        return sorted(sources)
+
+    manifest_dir = os.path.dirname(os.path.abspath(target))
+    sources = []
+    with open(target, 'r') as manifest:
+        for line in manifest:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            if line.startswith('{'):
+                entry = json.loads(line)
+                line = entry.get('path') or entry.get('file') or entry.get('source_file')
+                if not line:
+                    continue
+            if not os.path.isabs(line):
+                line = os.path.join(manifest_dir, line)
+            sources.append(os.path.abspath(line))
+    return sources
+
+
+def _remember_result(result, cache_dir, variant=None):
+    # Final per-file results are kept so incremental runs can reuse them for
+    # files outside the diff without touching the stage caches at all.
+    # Provisional results depend on the triage thresholds and are not kept.
+    if cache_dir and "error" not in result and not result.get("provisional"):
+        _store_result(result, cache_dir, result_cache_key(result["file"], PROMPT_PATH, MODEL_NAME, variant=variant))
+    return result
+
+
+def _store_result(result, cache_dir, cache_key):
+    store_cached(cache_dir, "result", cache_key, {key: value for key, value in result.items() if key != "profile"})
+
+
+def _batch_worker(source_file, options):
+    # cppcheck output is streamed in memory, so workers share no files;
+    # stdout is kept free for the JSON lines
+    try:
+        with contextlib.redirect_stdout(sys.stderr):
+            return _remember_result(evaluate_file(source_file, **options), options.get("cache_dir"),
+                                    llm_variant(**options))
+    except Exception as e:
+        return {"file": source_file, "error": str(e)}
+
+
+def _judge_alone(source_file, options):
+    return [run_llm_stage(source_file, **_llm_options(options))]
+
+
+def _profiled(function, *args):
+    # Runs function recording into a fresh dict; returns (result, timings)
+    timings = {}
+    with profiling.collecting(timings):
+        return function(*args), timings
+
+
+def _batch_chunk_worker(chunk, options, cppcheck_many=True, cppcheck_jobs=None, llm_batch=0):
+    # With cppcheck_many a single cppcheck process covers the whole chunk; with
+    # llm_batch the chunk's files are packed llm_batch at a time into one LLM
+    # request. Either way the LLM requests run alongside the static stage.
+    cache_dir = options.get("cache_dir")
+    variant = result_variant(llm_batch, **options)
+    # Timings of shared work (the chunk's static stage, a packed request) are
+    # reported on every file that shared it
+    with contextlib.redirect_stdout(sys.stderr):
+        with ThreadPoolExecutor(max_workers=CHUNK_LLM_THREADS + 1) as stages:
+            if cppcheck_many:
+                static_future = stages.submit(_profiled, run_static_stage_many, chunk, cache_dir, cppcheck_jobs)
+            else:
+                static_future = stages.submit(_profiled, lambda: {source: run_static_stage(source, cache_dir=cache_dir)
+                                                                  for source in chunk})
+            triage_below, triage_above = options.get("triage_below"), options.get("triage_above")
+            triage = triage_below is not None or triage_above is not None
+            if triage or not options.get("concurrent", True):
+                # Triage picks the files worth judging from the static scores first
+                try:
+                    static_future.result()
+                except Exception as e:
+                    return [{"file": source, "error": str(e)} for source in chunk]
+            skipped = []
+            if triage:
+                static_results = static_future.result()[0]
+                skipped = [source for source in chunk
+                           if is_decisive(static_results.get(source), triage_below, triage_above)]
+            judged = [source for source in chunk if source not in skipped]
+            if llm_batch > 0:
+                groups = [judged[i:i + llm_batch] for i in range(0, len(judged), llm_batch)]
+                group_futures = [stages.submit(_profiled, run_llm_stage_group, group, cache_dir) for group in groups]
+            else:
+                groups = [[source] for source in judged]
+                group_futures = [stages.submit(_profiled, _judge_alone, group[0], options) for group in groups]
+            try:
+                static_results, static_timings = static_future.result()
+            except Exception as e:
+                return [{"file": source, "error": str(e)} for source in chunk]
+
+            results = []
+            if skipped:
+                # Decisive files get a static-only provisional result
+                groups.append(skipped)
+                group_futures.append(None)
+            for group, group_future in zip(groups, group_futures):
+                if group_future is None:
+                    verdicts, llm_timings = [None] * len(group), {}
+                else:
+                    try:
+                        verdicts, llm_timings = group_future.result()
+                    except Exception as e:
+                        results.extend({"file": source, "error": str(e)} for source in group)
+                        continue
+                for source, verdict in zip(group, verdicts):
+                    result = score_results(source, static_results.get(source), verdict)
+                    if options.get("profile"):
+                        result["profile"] = dict(static_timings, **llm_timings)
+                    results.append(_remember_result(result, cache_dir, variant))
+            return results
+
+
+def _static_settings():
+    # Everything a worker needs to reproduce this process's static stage
+    return cppcheck_settings(), benchmark_settings()
+
+
+def _restore_static_settings(cppcheck, benchmarks):
+    restore_cppcheck_settings(*cppcheck)
+    restore_benchmark_settings(*benchmarks)
+
+
+def _init_worker(client_args, static_settings):
+    configure_client(*client_args)
+    _restore_static_settings(*static_settings)
+
+
+def _task_settings():
+    # The coordinator's check profile, kernel setup and benchmark regressions,
+    # sent with every task: they change the findings, and the coordinator
+    # caches results under its own settings
+    check_profile, setup_args, _ = cppcheck_settings()
+    return {"check_profile": check_profile, "setup_args": setup_args, "benchmarks": benchmark_settings()}
+
+
+def _apply_task_settings(settings):
+    # Adopts the coordinator's settings for the next task, keeping this node's
+    # build dir; returns an error when its kernel tree is not here at the same path
+    for arg in settings["setup_args"]:
+        if arg.startswith("-I"):
+            path = arg[len("-I"):]
+        elif arg.startswith("--include="):
+            path = arg[len("--include="):]
+        else:
+            continue
+        if not os.path.exists(path):
+            return f"kernel setup path {path} from the coordinator does not exist on {socket.gethostname()}"
+    restore_cppcheck_settings(settings["check_profile"], settings["setup_args"], cppcheck_settings()[2])
+    restore_benchmark_settings(*settings["benchmarks"])
+    return None
+
+
+def _run_pool(sources, workers=None, cppcheck_batch=0, cppcheck_jobs=None, llm_batch=0,
+              max_in_flight=DEFAULT_MAX_IN_FLIGHT, rpm=None, tpm=None, **options):
+    # Yields one result dict per source as workers finish. Each worker process
+    # keeps one Gemini client for all of its files and an equal share of the
+    # run's requests/min and tokens/min quota.
+    workers = workers or os.cpu_count() or 1
+    rpm_share = rpm / workers if rpm else None
+    tpm_share = tpm / workers if tpm else None
+    with ProcessPoolExecutor(max_workers=workers, initializer=_init_worker,
+                             initargs=((max_in_flight, rpm_share, tpm_share), _static_settings())) as pool:
+        chunk_size = cppcheck_batch or llm_batch
+        if chunk_size > 0:
+            chunks = [sources[i:i + chunk_size] for i in range(0, len(sources), chunk_size)]
+            futures = [pool.submit(_batch_chunk_worker, chunk, options, cppcheck_batch > 0, cppcheck_jobs, llm_batch)
+                       for chunk in chunks]
+        else:
+            futures = [pool.submit(_batch_worker, source, options) for source in sources]
+        for future in as_completed(futures):
+            result = future.result()
+            yield from (result if isinstance(result, list) else [result])
+
+
+def report_profiles(results, profile_json=None):
+    # Per-stage percentile table on stderr, plus an optional JSON export
+    profiles = [dict(result["profile"], file=result["file"]) for result in results if "profile" in result]
+    if not profiles:
+        return
+    summary = profiling.summarize(profiles)
+    print(profiling.format_table(summary), file=sys.stderr)
+    if profile_json:
+        profiling.export(profile_json, profiles, summary)
+
+
+def _emit(result, store=None):
+    # One JSON line on stdout, and a row in the result store if there is one
+    if store:
+        store.add(result)
+    print(json.dumps({key: value for key, value in result.items() if key != "static_findings"}), flush=True)
+
+
+def run_batch(target, profile_json=None, store=None, **options):
+    failures = 0
+    profiled = []
+    for result in _run_pool(collect_sources(target), **options):
+        if "error" in result:
+            failures += 1
+        if "profile" in result:
+            # Keep just the timings rather than whole results
+            profiled.append({"file": result["file"], "profile": result["profile"]})
+        _emit(result, store)
+    report_profiles(profiled, profile_json)
+    return failures
+
+
+def _static_worker(source_file, cache_dir=None):
+    with contextlib.redirect_stdout(sys.stderr):
+        return run_static_stage(source_file, cache_dir=cache_dir)
+
+
+def _run_static_pool(sources, workers=None, cache_dir=None):
+    with ProcessPoolExecutor(max_workers=workers, initializer=_restore_static_settings,
+                             initargs=_static_settings()) as pool:
+        return dict(zip(sources, pool.map(_static_worker, sources, [cache_dir] * len(sources))))
+
+
+def run_batch_job(target, workers=None, cache_dir=None, llm_batch=0, triage_below=None, triage_above=None, store=None):
+    # Overnight mode: every uncached LLM verdict goes into one job on the
+    # asynchronous batch API while cppcheck runs locally, then both are joined.
+    # With triage, cppcheck runs first so decisive files stay out of the job.
+    sources = collect_sources(target)
+    triage = triage_below is not None or triage_above is not None
+    static_results = _run_static_pool(sources, workers, cache_dir) if triage else None
+    verdicts = {}
+    pending = []
+    for source in sources:
+        if triage and is_decisive(static_results[source], triage_below, triage_above):
+            verdicts[source] = None
+            continue
+        cached = None
+        if cache_dir:
+            cached = load_cached(cache_dir, "llm", llm_cache_key(source, PROMPT_PATH, MODEL_NAME, PACKED_VARIANT))
+        if cached is not None:
+            verdicts[source] = cached
+        else:
+            pending.append(source)
+
+    group_size = max(llm_batch, 1)
+    groups = [pending[i:i + group_size] for i in range(0, len(pending), group_size)]
+    job_name = submit_batch_job(groups, PROMPT_PATH) if groups else None
+    if job_name:
+        print(f"Submitted batch job {job_name} with {len(groups)} request(s)", file=sys.stderr)
+
+    if not triage:
+        static_results = _run_static_pool(sources, workers, cache_dir)
+
+    if job_name:
+        for group, text in zip(groups, wait_for_batch_job(job_name)):
+            for source, score in zip(group, parse_batch_scores(text, len(group))):
+                if score is None:
+                    continue
+                verdicts[source] = {"score": score}
+                if cache_dir:
+                    store_cached(cache_dir, "llm", llm_cache_key(source, PROMPT_PATH, MODEL_NAME, PACKED_VARIANT),
+                                 verdicts[source])
+
+    failures = 0
+    for source in sources:
+        try:
+            with contextlib.redirect_stdout(sys.stderr):
+                verdict = verdicts[source] if source in verdicts else run_llm_stage(source, cache_dir)
+            result = _remember_result(score_results(source, static_results[source], verdict), cache_dir,
+                                      PACKED_VARIANT)
+        except Exception as e:
+            result = {"file": source, "error": str(e)}
+            failures += 1
+        _emit(result, store)
+    return failures
+
+
+def summarize_results(results):
+    scored = [result for result in results if "error" not in result]
+    summary = {
+        "files": len(results),
+        "failed": len(results) - len(scored),
+        "reanalyzed": sum(1 for result in results if not result.get("reused")),
+        "reused": sum(1 for result in results if result.get("reused"))
+    }
+    if scored:
+        final_scores = [result["final_score"] for result in scored]
+        summary["mean_final_score"] = sum(final_scores) / len(final_scores)
+        summary["min_final_score"] = min(final_scores)
+        summary["max_final_score"] = max(final_scores)
+    return summary
+
+
+def run_incremental(target, base_rev, head_rev=None, cache_dir=None, profile_json=None, store=None, **options):
+    # Only files changed between the two revisions (or since base_rev in the
+    # working tree) are re-judged; every other file reuses its last stored
+    # result, falling back to a full analysis when it has never been scored.
+    sources = collect_sources(target)
+    cwd = os.path.dirname(sources[0]) if sources else None
+    try:
+        changed = changed_files(base_rev, head_rev, cwd=cwd)
+        # Files are read from the working tree, so it has to be head_rev
+        drifted = sorted(changed_files(head_rev, cwd=cwd) & set(sources)) if head_rev else []
+    except subprocess.CalledProcessError as e:
+        print(f"Error running git: {e.stderr.strip()}")
+        return 1
+    if drifted:
+        print(f"The working tree differs from {head_rev} in {len(drifted)} source file(s), e.g. {drifted[0]}; "
+              f"check out {head_rev} first or leave out --until")
+        return 1
+
+    results = []
+    pending = []
+    for source in sources:
+        if source not in changed:
+            key = result_cache_key(source, PROMPT_PATH, MODEL_NAME, variant=result_variant(**options))
+            cached = load_cached(cache_dir, "result", key)
+            if cached is not None:
+                cached["reused"] = True
+                results.append(cached)
+                continue
+        pending.append(source)
+
+    for result in _run_pool(pending, cache_dir=cache_dir, **options):
+        results.append(result)
+
+    results.sort(key=lambda result: result["file"])
+    for result in results:
+        _emit(result, store)
+    print(json.dumps({"summary": summarize_results(results)}), flush=True)
+    report_profiles(results, profile_json)
+    return sum(1 for result in results if "error" in result)
+
+
+def _stored_result(source_file, cache_dir, variant):
+    try:
+        return load_cached(cache_dir, "result", result_cache_key(source_file, PROMPT_PATH, MODEL_NAME, variant=variant))
+    except OSError:
+        return None
+
+
+def _leased_result_key(root, files, name, variant):
+    # Result cache key of the files as leased: a copy laid out like the
+    # worker's, since the coordinator's own may change before the result is back
+    with tempfile.TemporaryDirectory(prefix="analyzer_lease_") as lease_dir:
+        _write_files(lease_dir, files)
+        return result_cache_key(os.path.join(lease_dir, name), PROMPT_PATH, MODEL_NAME, variant=variant)
+
+
+def run_coordinator(target, queue_path, listen=DEFAULT_LISTEN, cache_dir=None, lease_seconds=DEFAULT_LEASE_SECONDS,
+                    max_attempts=DEFAULT_MAX_ATTEMPTS, profile_json=None, store=None, **options):
+    # Queues every source and serves leases to --worker processes until each
+    # file is done or out of attempts, printing results as they come in. The
+    # queue lives in queue_path, so a restarted coordinator resumes the run.
+    # With cache_dir, results are stored there and unchanged files are
+    # answered from it without reaching any worker.
+    variant = llm_variant(**options)
+    queue = TaskQueue(queue_path, max_attempts)
+    added = queue.enqueue(collect_sources(target))
+    reuse, result_key = None, None
+    if cache_dir:
+        reuse = lambda path: _stored_result(path, cache_dir, variant)
+        result_key = lambda root, files, name: _leased_result_key(root, files, name, variant)
+    coordinator = dispatch.Coordinator(queue, {key: options[key] for key in TASK_OPTION_KEYS if key in options},
+                                       lease_seconds, reuse, _task_settings(), result_key)
+    reused = coordinator.settle_reusable()
+    host, port = listen.rsplit(':', 1)
+    host, port = coordinator.start(host, int(port))
+    print(f"Queued {added} new files in {queue_path}, {reused} answered from the cache; "
+          f"listening on http://{host}:{port}", file=sys.stderr)
+
+    cursor = 0
+    profiled = []
+    while True:
+        finished = queue.remaining() == 0
+        while True:
+            cursor, results = queue.results_since(cursor)
+            if not results:
+                break
+            for result, key in results:
+                # Keyed on the content that was leased, not the file as it is now
+                if key and not result.get("reused") and "error" not in result and not result.get("provisional"):
+                    _store_result(result, cache_dir, key)
+                if "profile" in result:
+                    profiled.append({"file": result["file"], "profile": result["profile"]})
+                _emit(result, store)
+        if finished:
+            break
+        time.sleep(0.5)
+
+    summary = queue.summary()
+    print(json.dumps({"summary": summary}), flush=True)
+    report_profiles(profiled, profile_json)
+    time.sleep(COORDINATOR_GRACE_SECONDS)
+    coordinator.stop()
+    queue.close()
+    return summary["failed"]
+
+
+def _same_files(root, files):
+    for name, text in files.items():
+        try:
+            with open(os.path.join(root, name), 'r') as f:
+                if f.read() != text:
+                    return False
+        except OSError:
+            return False
+    return True
+
+
+def _write_files(task_dir, files):
+    # Lays the leased files out under task_dir; names must stay inside it
+    for name, text in files.items():
+        name = os.path.normpath(name)
+        if os.path.isabs(name) or name.split(os.sep)[0] == os.pardir:
+            raise ValueError(f"task file {name} is outside the task directory")
+        local_path = os.path.join(task_dir, name)
+        os.makedirs(os.path.dirname(local_path), exist_ok=True)
+        with open(local_path, 'w') as f:
+            f.write(text)
+
+
+def _run_task(task, cache_dir=None):
+    # Analyzes the file in place when this node sees the same source and
+    # headers at the same paths (a shared checkout), otherwise a copy of the
+    # leased source with its local headers laid out around it as on the
+    # coordinator, so local includes resolve either way
+    path = task["path"]
+    options = dict(task["options"], cache_dir=cache_dir)
+    error = _apply_task_settings(task["settings"])
+    if error:
+        return {"file": path, "error": error}
+    files = dict(task["headers"], **{task["name"]: task["source"]})
+    try:
+        with contextlib.redirect_stdout(sys.stderr):
+            if _same_files(task["root"], files):
+                result = evaluate_file(path, **options)
+            else:
+                with tempfile.TemporaryDirectory(prefix="analyzer_task_") as task_dir:
+                    _write_files(task_dir, files)
+                    result = evaluate_file(os.path.join(task_dir, task["name"]), **options)
+    except Exception as e:
+        return {"file": path, "error": str(e)}
+    result["file"] = path
+    return result
+
+
+def _queue_worker(url, worker, cache_dir=None):
+    # Leases and runs tasks until the coordinator has none left; returns the
+    # number of tasks that failed here. A failure is reported so the task is
+    # retried elsewhere; a lost lease means another worker already has it.
+    failures = 0
+    while True:
+        task = dispatch.wait_for_task(url, worker)
+        if task is None:
+            return failures
+        with dispatch.LeaseKeeper(url, task) as keeper:
+            result = _run_task(task, cache_dir)
+        if keeper.lost:
+            print(f"Lease on {task['path']} expired before it finished, dropping the result.", file=sys.stderr)
+            continue
+        route, payload = "/complete", {"id": task["id"], "token": task["token"], "result": result}
+        if "error" in result:
+            failures += 1
+            route, payload = "/fail", {"id": task["id"], "token": task["token"], "error": result["error"]}
+        try:
+            dispatch.call(url, route, payload)
+        except (OSError, ValueError) as e:
+            # The lease runs out and the task is handed out again
+            print(f"Could not report {task['path']} to {url}: {e}", file=sys.stderr)
+
+
+def run_worker(url, workers=None, cache_dir=None, max_in_flight=DEFAULT_MAX_IN_FLIGHT, rpm=None, tpm=None):
+    # Stateless: any number of these can join or leave a coordinator's run.
+    # rpm and tpm are this node's quota, split over its worker processes.
+    workers = workers or os.cpu_count() or 1
+    rpm_share = rpm / workers if rpm else None
+    tpm_share = tpm / workers if tpm else None
+    node = socket.gethostname()
+    with ProcessPoolExecutor(max_workers=workers, initializer=_init_worker,
+                             initargs=((max_in_flight, rpm_share, tpm_share), _static_settings())) as pool:
+        futures = [pool.submit(_queue_worker, url, f"{node}/{index}", cache_dir) for index in range(workers)]
+        return sum(future.result() for future in futures)
+
 
 if __name__ == "__main__":
-    if len(sys.argv) != 2:
+    parser = argparse.ArgumentParser(description="Score C sources with static analysis and an LLM judge.")
+    parser.add_argument("source_file", nargs="?", help="C source file to analyze")
+    parser.add_argument("--batch", metavar="DIR_OR_MANIFEST",
+                        help="analyze every source in a directory or listed in a manifest, one JSON line per file")
+    parser.add_argument("--workers", type=int, default=None,
+                        help="number of worker processes for --batch (default: CPU count)")
+    parser.add_argument("--cppcheck-batch", type=int, default=0, metavar="N",
+                        help="with --batch, analyze N files per cppcheck invocation (default: one run per file)")
+    parser.add_argument("--cppcheck-jobs", type=int, default=None, metavar="J",
+                        help="pass -jJ to each multi-file cppcheck run")
+    parser.add_argument("--check-profile", choices=sorted(CHECK_PROFILES), default="all",
+                        help="cppcheck checker families to enable: all, or only those that affect the score")
+    parser.add_argument("--kernel-dir", metavar="DIR", default=None,
+                        help="prepared kernel tree whose include paths and kconfig.h are passed to cppcheck")
+    parser.add_argument("--arch", default="x86", help="architecture directory used with --kernel-dir (default: x86)")
+    parser.add_argument("--cppcheck-build-dir", metavar="DIR", default=None,
+                        help="keep cppcheck's analysis cache in DIR so unchanged files are not re-analyzed")
+    parser.add_argument("--llm-batch", type=int, default=0, metavar="N",
+                        help="with --batch, pack N files into each LLM request")
+    parser.add_argument("--llm-batch-api", action="store_true",
+                        help="with --batch, submit LLM requests through the asynchronous batch API and wait for the job")
+    parser.add_argument("--stream", action="store_true",
+                        help="stream the LLM response instead of waiting for the complete report")
+    parser.add_argument("--stop-on-score", action="store_true",
+                        help="with --stream, stop reading the response once the final score line has arrived")
+    parser.add_argument("--structured", action="store_true",
+                        help="have the judge return schema-constrained per-pillar scores and compute the total locally")
+    parser.add_argument("--scores-only", action="store_true",
+                        help="with --structured, omit the per-pillar summaries from the response")
+    parser.add_argument("--chunk-lines", type=int, default=None, metavar="N",
+                        help="judge files longer than N lines one file_operations handler (or helper group) at a time")
+    parser.add_argument("--max-in-flight", type=int, default=DEFAULT_MAX_IN_FLIGHT, metavar="N",
+                        help=f"maximum concurrent LLM requests per process (default: {DEFAULT_MAX_IN_FLIGHT})")
+    parser.add_argument("--rpm", type=float, default=None,
+                        help="LLM requests per minute allowed for the whole run; requests are paced just under it")
+    parser.add_argument("--tpm", type=float, default=None,
+                        help="LLM input tokens per minute allowed for the whole run, estimated from prompt size")
+    parser.add_argument("--profile", action="store_true",
+                        help="record per-stage timings and token usage and print a p50/p95/p99 summary")
+    parser.add_argument("--profile-json", metavar="PATH", default=None,
+                        help="with --batch, also write per-file timings and the summary to PATH (implies --profile)")
+    parser.add_argument("--sequential", action="store_true",
+                        help="run cppcheck and the LLM one after the other instead of concurrently")
+    parser.add_argument("--triage-below", type=float, default=None, metavar="SCORE",
+                        help="skip the LLM and report a provisional static-only score when the static score is below SCORE")
+    parser.add_argument("--triage-above", type=float, default=None, metavar="SCORE",
+                        help="skip the LLM and report a provisional static-only score when the static score is above SCORE")
+    parser.add_argument("--cache-dir", default=None,
+                        help="reuse cppcheck and LLM results stored under this directory, keyed by content hash")
+    parser.add_argument("--bench-results", metavar="PATH", default=None,
+                        help="report slowdowns found by benchmarks/driver_bench (run_bench.py --baseline) as findings")
+    parser.add_argument("--changed-since", metavar="REV", default=None,
+                        help="with --batch, only re-analyze files changed since REV and reuse stored results for the rest")
+    parser.add_argument("--until", metavar="REV", default=None,
+                        help="compare --changed-since against REV instead of the working tree")
+    parser.add_argument("--coordinator", metavar="DIR_OR_MANIFEST", default=None,
+                        help="queue every source for --worker processes on other nodes and collect their results")
+    parser.add_argument("--queue-db", metavar="PATH", default=".analysis_queue.db",
+                        help="with --coordinator, SQLite file holding the task queue (default: .analysis_queue.db)")
+    parser.add_argument("--listen", metavar="HOST:PORT", default=DEFAULT_LISTEN,
+                        help=f"with --coordinator, address to serve workers on (default: {DEFAULT_LISTEN})")
+    parser.add_argument("--lease-seconds", type=float, default=DEFAULT_LEASE_SECONDS,
+                        help=f"with --coordinator, seconds a worker may stay silent before its task is handed out again "
+                             f"(default: {DEFAULT_LEASE_SECONDS})")
+    parser.add_argument("--max-attempts", type=int, default=DEFAULT_MAX_ATTEMPTS,
+                        help=f"with --coordinator, leases per file before it is reported as failed "
+                             f"(default: {DEFAULT_MAX_ATTEMPTS})")
+    parser.add_argument("--results-db", metavar="PATH", default=None,
+                        help="also record every result, its findings, pillar scores and timings in a SQLite store at PATH")
+    parser.add_argument("--worker", metavar="URL", default=None,
+                        help="run --workers processes that take files from the coordinator at URL")
+    args = parser.parse_args()
+    if (args.llm_batch or args.llm_batch_api) and (args.structured or args.scores_only or args.stream or
+                                                   args.stop_on_score or args.chunk_lines):
+        print("--llm-batch and --llm-batch-api judge with the packed free-text rubric; they cannot be combined "
+              "with --structured, --scores-only, --stream, --stop-on-score or --chunk-lines")
+        sys.exit(1)
+    configure_client(args.max_in_flight, args.rpm, args.tpm)
+    configure_cppcheck(args.check_profile, args.kernel_dir, args.arch, args.cppcheck_build_dir)
+    if args.cppcheck_batch and has_whole_program_checks():
+        print("--cppcheck-batch needs --check-profile scoring: the unusedFunction check of the 'all' profile "
+              "sees the whole batch, and is skipped with --cppcheck-jobs, so scores would differ from single runs")
+        sys.exit(1)
+    if args.bench_results and not configure_benchmarks(args.bench_results):
+        sys.exit(1)
+
+    store = None
+    if args.results_db and not args.worker:
+        store = ResultStore(args.results_db, " ".join(sys.argv), vars(args))
+        # Every mode below ends in sys.exit; the run's totals are written on the way out
+        atexit.register(store.close)
+
+    if args.worker:
+        sys.exit(1 if run_worker(args.worker, workers=args.workers, cache_dir=args.cache_dir,
+                                 max_in_flight=args.max_in_flight, rpm=args.rpm, tpm=args.tpm) else 0)
+
+    if args.coordinator:
+        if not os.path.exists(args.coordinator):
+            print(f"File not found: {args.coordinator}")
+            sys.exit(1)
+        sys.exit(1 if run_coordinator(args.coordinator, args.queue_db, args.listen, cache_dir=args.cache_dir,
+                                      lease_seconds=args.lease_seconds, max_attempts=args.max_attempts,
+                                      profile_json=args.profile_json, store=store, concurrent=not args.sequential,
+                                      stream=args.stream or args.stop_on_score, stop_on_score=args.stop_on_score,
+                                      structured=args.structured or args.scores_only,
+                                      include_rationale=not args.scores_only, chunk_lines=args.chunk_lines,
+                                      profile=args.profile or bool(args.profile_json),
+                                      triage_below=args.triage_below, triage_above=args.triage_above) else 0)
+
+    if args.batch:
+        if not os.path.exists(args.batch):
+            print(f"File not found: {args.batch}")
+            sys.exit(1)
+        options = dict(workers=args.workers, concurrent=not args.sequential, cache_dir=args.cache_dir,
+                       stream=args.stream or args.stop_on_score, stop_on_score=args.stop_on_score,
+                       structured=args.structured or args.scores_only, include_rationale=not args.scores_only,
+                       chunk_lines=args.chunk_lines,
+                       cppcheck_batch=args.cppcheck_batch, cppcheck_jobs=args.cppcheck_jobs,
+                       llm_batch=args.llm_batch, max_in_flight=args.max_in_flight, rpm=args.rpm, tpm=args.tpm,
+                       profile=args.profile or bool(args.profile_json), profile_json=args.profile_json,
+                       triage_below=args.triage_below, triage_above=args.triage_above)
+        if args.llm_batch_api:
+            sys.exit(1 if run_batch_job(args.batch, workers=args.workers, cache_dir=args.cache_dir,
+                                        llm_batch=args.llm_batch, triage_below=args.triage_below,
+                                        triage_above=args.triage_above, store=store) else 0)
+        if args.changed_since:
+            if not args.cache_dir:
+                print("--changed-since requires --cache-dir to reuse results for unchanged files")
+                sys.exit(1)
+            sys.exit(1 if run_incremental(args.batch, args.changed_since, args.until, store=store, **options) else 0)
+        sys.exit(1 if run_batch(args.batch, store=store, **options) else 0)
+
+    if not args.source_file:
         print("Usage: python script.py <source_file.c>")
         sys.exit(1)
-    
-    source_file = sys.argv[1]
-    
+
+    source_file = args.source_file
+
     if not os.path.isabs(source_file):
         source_file = os.path.abspath(source_file)
-    
+
     if not os.path.exists(source_file):
         print(f"File not found: {source_file}")
         sys.exit(1)
-    
-    score = analyze_code(source_file)
 
-    print("Final Score: ",score)
\ No newline at end of file
+    score = analyze_code(source_file, store=store, concurrent=not args.sequential, cache_dir=args.cache_dir,
+                         stream=args.stream or args.stop_on_score, stop_on_score=args.stop_on_score,
+                         structured=args.structured or args.scores_only, include_rationale=not args.scores_only,
+                         chunk_lines=args.chunk_lines, profile=args.profile or bool(args.profile_json),
+                         triage_below=args.triage_below, triage_above=args.triage_above)
+
+    print("Final Score: ",score)
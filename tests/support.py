@@ -0,0 +1,36 @@
+import os
+import sys
+import types
+
+# Shared setup for the tests: puts the engine and benchmark modules on the
+# path, and stands in for the Gemini SDK and python-dotenv when they are not
+# installed so the pure parsing and scheduling logic can be tested offline.
+# Nothing here talks to the network.
+
+REPO_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+ENGINE_DIR = os.path.join(REPO_DIR, 'code-evaluation-engine')
+DRIVER_BENCH_DIR = os.path.join(REPO_DIR, 'benchmarks', 'driver_bench')
+
+for path in (ENGINE_DIR, DRIVER_BENCH_DIR):
+    if path not in sys.path:
+        sys.path.append(path)
+
+
+def _stub_module(name, **attributes):
+    module = types.ModuleType(name)
+    module.__dict__.update(attributes)
+    sys.modules[name] = module
+    return module
+
+
+try:
+    from google import genai  # noqa: F401
+except ImportError:
+    google = _stub_module('google')
+    google.genai = _stub_module('google.genai', Client=None)
+    google.genai.types = _stub_module('google.genai.types')
+
+try:
+    import dotenv  # noqa: F401
+except ImportError:
+    _stub_module('dotenv', load_dotenv=lambda *args, **kwargs: False)
@@ -0,0 +1,28 @@
+import unittest
+
+import support  # noqa: F401
+from qualitative import parse_batch_scores
+
+
+class ParseBatchScoresTest(unittest.TestCase):
+    def test_scores_in_request_order(self):
+        text = '{"files": [{"id": "F1", "score": 40}, {"id": "F0", "score": 91.6}]}'
+        self.assertEqual(parse_batch_scores(text, 2), [92, 40])
+
+    def test_code_fence_is_stripped(self):
+        text = '```json\n{"files": [{"id": "F0", "score": 70}]}\n```'
+        self.assertEqual(parse_batch_scores(text, 1), [70])
+
+    def test_missing_and_unusable_entries_are_none(self):
+        text = ('{"files": [{"id": "F0", "score": 101}, {"id": "F1", "score": "80"}, '
+                '{"id": "F3", "score": 50}, {"id": "X2", "score": 50}, "F2"]}')
+        self.assertEqual(parse_batch_scores(text, 3), [None, None, None])
+
+    def test_unparseable_response(self):
+        self.assertEqual(parse_batch_scores("score: 80/100", 2), [None, None])
+        self.assertEqual(parse_batch_scores(None, 1), [None])
+        self.assertEqual(parse_batch_scores("[1, 2]", 1), [None])
+
+
+if __name__ == '__main__':
+    unittest.main()
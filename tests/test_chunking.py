@@ -0,0 +1,87 @@
+import os
+import unittest
+
+import support
+from chunking import find_functions, handler_roles, mask_source, split_source
+
+SOURCE = r'''#include <linux/fs.h>
+
+#define LOG(x) do { pr_debug("{%s}", x); } while (0)
+
+static int counter;
+
+static int helper_a(int x)
+{
+    return x + 1;
+}
+
+static int helper_b(int x)
+{
+    /* } not a brace */
+    return x * 2;
+}
+
+static ssize_t demo_read(struct file *f, char __user *buf, size_t len, loff_t *off)
+{
+    if (len) {
+        counter++;
+    }
+    return helper_a(len);
+}
+
+static const struct file_operations demo_fops = {
+    .owner = THIS_MODULE,
+    .read = demo_read,
+};
+
+static int __init demo_init(void)
+{
+    return helper_b(0);
+}
+module_init(demo_init);
+'''
+
+
+class ChunkingTest(unittest.TestCase):
+    def test_mask_keeps_length_and_lines(self):
+        masked = mask_source(SOURCE)
+        self.assertEqual(len(masked), len(SOURCE))
+        self.assertEqual(masked.count('\n'), SOURCE.count('\n'))
+        self.assertNotIn('pr_debug', masked)
+        self.assertNotIn('not a brace', masked)
+
+    def test_find_functions(self):
+        functions = find_functions(SOURCE)
+        self.assertEqual([name for name, _, _ in functions], ['helper_a', 'helper_b', 'demo_read', 'demo_init'])
+        for name, start, end in functions:
+            self.assertTrue(SOURCE[start:end].endswith('}'))
+            self.assertIn(name + '(', SOURCE[start:end].split('\n')[0])
+
+    def test_handler_roles(self):
+        self.assertEqual(handler_roles(SOURCE), {'demo_read': 'read', 'demo_init': 'init'})
+
+    def test_handlers_get_their_own_units(self):
+        context, units = split_source(SOURCE)
+        self.assertEqual([unit['name'] for unit in units],
+                         ['read: demo_read', 'init: demo_init', 'helpers: helper_a, helper_b'])
+        self.assertEqual(units[0]['functions'], ['demo_read'])
+        self.assertEqual(units[0]['lines'], units[0]['text'].count('\n') + 1)
+        self.assertIn('demo_fops', context)
+        self.assertIn('static int counter;', context)
+        self.assertNotIn('return x + 1', context)
+
+    def test_helpers_split_at_max_chunk_lines(self):
+        _, units = split_source(SOURCE, max_chunk_lines=5)
+        self.assertEqual([unit['name'] for unit in units][2:], ['helpers: helper_a', 'helpers: helper_b'])
+
+    def test_bundled_driver_covers_every_function(self):
+        with open(os.path.join(support.ENGINE_DIR, 'good_driver.c'), 'r') as f:
+            text = f.read()
+        _, units = split_source(text)
+        chunked = [name for unit in units for name in unit['functions']]
+        self.assertEqual(sorted(chunked), sorted(name for name, _, _ in find_functions(text)))
+        self.assertTrue(any(unit['name'].startswith('read_iter: ') for unit in units))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,39 @@
+import unittest
+
+import support  # noqa: F401
+from run_bench import find_regressions
+
+
+def run(ops_per_sec, p99, driver="good_driver", params="", op="read", threads=4, size=64):
+    return {"driver": driver, "source": driver + ".c", "params": params, "op": op, "threads": threads,
+            "size": size, "ops_per_sec": ops_per_sec, "latency_ns": {"p99": p99}}
+
+
+class FindRegressionsTest(unittest.TestCase):
+    def test_changes_within_tolerance_are_noise(self):
+        self.assertEqual(find_regressions([run(91, 1090)], [run(100, 1000)], 0.10), [])
+
+    def test_throughput_drop(self):
+        regressions = find_regressions([run(80, 1000)], [run(100, 1000)], 0.10)
+        self.assertEqual(regressions, [{"driver": "good_driver", "source": "good_driver.c", "params": "",
+                                        "op": "read", "threads": 4, "size": 64, "metric": "ops_per_sec",
+                                        "baseline": 100, "current": 80}])
+
+    def test_latency_rise_and_throughput_drop_are_both_reported(self):
+        regressions = find_regressions([run(50, 3000)], [run(100, 1000)], 0.10)
+        self.assertEqual([(r["metric"], r["baseline"], r["current"]) for r in regressions],
+                         [("ops_per_sec", 100, 50), ("p99_ns", 1000, 3000)])
+
+    def test_runs_are_matched_on_the_full_key(self):
+        baseline = [run(100, 1000), run(1000, 100, params="read_mostly=1"), run(100, 1000, threads=1),
+                    run(100, 1000, size=256), run(100, 1000, op="write"), run(100, 1000, driver="mid_driver")]
+        regressions = find_regressions([run(100, 1000, params="read_mostly=1")], baseline, 0.10)
+        self.assertEqual([r["metric"] for r in regressions], ["ops_per_sec", "p99_ns"])
+        self.assertEqual(find_regressions([run(1, 1000, threads=8)], baseline, 0.10), [])
+
+    def test_zero_baseline_is_skipped(self):
+        self.assertEqual(find_regressions([run(0, 5000)], [run(0, 0)], 0.10), [])
+
+
+if __name__ == '__main__':
+    unittest.main()
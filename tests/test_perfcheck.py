@@ -0,0 +1,103 @@
+import os
+import unittest
+
+import support
+import perfcheck
+
+TEMPLATE = r'''#include <linux/fs.h>
+
+static DEFINE_SPINLOCK(demo_lock);
+static unsigned long demo_reads;
+static char demo_buf[64];
+
+static ssize_t demo_read(struct file *f, char __user *buf, size_t len, loff_t *off)
+{
+%s
+    return len;
+}
+
+static ssize_t demo_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+    return 0;
+}
+
+static const struct file_operations demo_fops = {
+    .owner = THIS_MODULE,
+    .read = demo_read,
+    .read_iter = demo_read_iter,
+};
+'''
+
+
+def findings(body, source_file='demo.c'):
+    text = TEMPLATE % body
+    return [(finding["id"], finding["line"]) for check in perfcheck.CHECKS for finding in check(source_file, text)]
+
+
+def ids(body):
+    return [finding_id for finding_id, _ in findings(body)]
+
+
+class PerfcheckTest(unittest.TestCase):
+    def test_clean_handler(self):
+        self.assertEqual(findings('    if (copy_to_user(buf, demo_buf, len))\n        return -EFAULT;'), [])
+
+    def test_hot_path_printk(self):
+        self.assertEqual(findings('    pr_info("read %zu\\n", len);'), [("hotPathPrintk", 9)])
+        self.assertEqual(ids('    printk(KERN_INFO "read\\n");'), ["hotPathPrintk"])
+        self.assertEqual(ids('    printk(KERN_ERR "failed\\n");\n    pr_debug("read\\n");'), [])
+
+    def test_shared_hot_counter(self):
+        self.assertEqual(ids('    demo_reads++;'), ["sharedHotCounter"])
+        self.assertEqual(ids('    unsigned long local = 0;\n    local++;'), [])
+
+    def test_legacy_file_operations(self):
+        text = (TEMPLATE % "").replace("    .read_iter = demo_read_iter,\n", "")
+        self.assertEqual([f["id"] for f in perfcheck.legacy_file_operations('demo.c', text)],
+                         ["legacyFileOperations"])
+
+    def test_sleep_and_alloc_in_handler(self):
+        self.assertEqual(ids('    msleep(10);'), ["sleepInHandler"])
+        self.assertEqual(ids('    char *tmp = kmalloc(len, GFP_KERNEL);\n    kfree(tmp);'), ["allocInHandler"])
+
+    def test_busy_wait_loop(self):
+        self.assertEqual(ids('    int i;\n    for (i = 0; i < 1000; i++)\n        ;'), ["busyWaitLoop"])
+        self.assertEqual(ids('    while (len--) {\n    }'), ["busyWaitLoop"])
+        self.assertEqual(ids('    do {\n        len--;\n    } while (len);'), [])
+
+    def test_byte_copy_loop(self):
+        self.assertEqual(ids('    int i;\n    for (i = 0; i < len; i++) {\n        demo_buf[i] = demo_buf[i + 1];\n    }'),
+                         ["byteCopyLoop"])
+        self.assertEqual(ids('    int i;\n    for (i = 0; i < len; i++)\n        put_user(demo_buf[i], buf + i);'),
+                         ["byteCopyLoop"])
+
+    def test_copy_under_spinlock(self):
+        body = '    spin_lock(&demo_lock);\n    copy_to_user(buf, demo_buf, len);\n    spin_unlock(&demo_lock);'
+        self.assertEqual(ids(body), ["copyUnderSpinlock"])
+        body = '    spin_lock(&demo_lock);\n    spin_unlock(&demo_lock);\n    copy_to_user(buf, demo_buf, len);'
+        self.assertEqual(ids(body), [])
+
+    def test_matches_in_comments_and_strings_are_ignored(self):
+        self.assertEqual(ids('    /* msleep(10); demo_reads++; */\n    const char *s = "kmalloc(1)";'), [])
+
+    def test_benchmark_regressions(self):
+        regression = {"driver": "demo", "source": "demo.c", "params": "read_mostly=1", "op": "read",
+                      "threads": 4, "size": 64, "metric": "ops_per_sec", "baseline": 100, "current": 50}
+        saved = perfcheck.benchmark_settings()
+        self.addCleanup(perfcheck.restore_benchmark_settings, *saved)
+        perfcheck.restore_benchmark_settings([regression])
+        self.assertEqual(findings("", source_file=os.path.join('some', 'dir', 'demo.c')),
+                         [("benchmarkRegression", 1)])
+        self.assertEqual(findings("", source_file='other.c'), [])
+
+    def test_failed_cppcheck_run_stays_none(self):
+        path = os.path.join(support.ENGINE_DIR, 'good_driver.c')
+        self.assertIsNone(perfcheck.with_native_findings(path, None))
+        cppcheck_results = {"errors": [{"id": "nullPointer"}]}
+        combined = perfcheck.with_native_findings(path, cppcheck_results)
+        self.assertEqual(combined["errors"][0], {"id": "nullPointer"})
+        self.assertEqual(cppcheck_results, {"errors": [{"id": "nullPointer"}]})
+
+
+if __name__ == '__main__':
+    unittest.main()
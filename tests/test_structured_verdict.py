@@ -0,0 +1,43 @@
+import json
+import unittest
+
+import support  # noqa: F401
+from qualitative import PILLAR_WEIGHTS, parse_structured_verdict
+
+
+def verdict(**scores):
+    entries = {pillar: {"category_score": 1.0} for pillar in PILLAR_WEIGHTS}
+    for pillar, score in scores.items():
+        entries[pillar] = {"category_score": score}
+    return json.dumps(entries)
+
+
+class ParseStructuredVerdictTest(unittest.TestCase):
+    def test_weighted_overall_score(self):
+        result = parse_structured_verdict(verdict(correctness=0.5, security=0.8, performance=0))
+        self.assertEqual(result["overall_score"], 20 + 20 + 20 + 0 + 5)
+        self.assertEqual(result["pillars"]["security"], 0.8)
+        self.assertEqual(set(result["pillars"]), set(PILLAR_WEIGHTS))
+
+    def test_perfect_verdict_scores_100(self):
+        self.assertEqual(parse_structured_verdict(verdict())["overall_score"], 100)
+
+    def test_invalid_json(self):
+        self.assertIn("error", parse_structured_verdict("score: 80/100"))
+        self.assertIn("error", parse_structured_verdict(None))
+        self.assertIn("error", parse_structured_verdict("[0.5]"))
+
+    def test_missing_pillar(self):
+        entries = json.loads(verdict())
+        del entries["code_quality"]
+        result = parse_structured_verdict(json.dumps(entries))
+        self.assertIn("code_quality", result["error"])
+
+    def test_out_of_range_or_non_numeric_scores(self):
+        for score in (1.5, -0.1, "0.9", True, None):
+            with self.subTest(score=score):
+                self.assertIn("correctness", parse_structured_verdict(verdict(correctness=score))["error"])
+
+
+if __name__ == '__main__':
+    unittest.main()
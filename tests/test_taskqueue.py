@@ -0,0 +1,104 @@
+import os
+import shutil
+import tempfile
+import unittest
+
+import support  # noqa: F401
+from taskqueue import TaskQueue
+
+
+class TaskQueueTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp(prefix="taskqueue_test_")
+        self.addCleanup(shutil.rmtree, self.directory, ignore_errors=True)
+        self.path = os.path.join(self.directory, "queue.db")
+        self.queue = self.open_queue()
+
+    def open_queue(self, max_attempts=2):
+        queue = TaskQueue(self.path, max_attempts=max_attempts)
+        self.addCleanup(queue.close)
+        return queue
+
+    def test_enqueue_is_idempotent(self):
+        self.assertEqual(self.queue.enqueue(["a.c", "b.c"]), 2)
+        self.assertEqual(self.queue.enqueue(["b.c", "c.c"]), 1)
+        self.assertEqual(self.queue.counts()["pending"], 3)
+
+    def test_lease_hands_out_each_task_once(self):
+        self.queue.enqueue(["a.c", "b.c"])
+        first = self.queue.lease("w1")
+        second = self.queue.lease("w2")
+        self.assertEqual((first["path"], first["attempts"]), ("a.c", 1))
+        self.assertEqual(second["path"], "b.c")
+        self.assertIsNone(self.queue.lease("w3"))
+        self.assertEqual(self.queue.remaining(), 2)
+
+    def test_only_the_lease_holder_completes(self):
+        self.queue.enqueue(["a.c"])
+        task = self.queue.lease("w1")
+        self.assertFalse(self.queue.complete(task["id"], "stale", {"file": "a.c", "final_score": 50}))
+        self.assertTrue(self.queue.complete(task["id"], task["token"], {"file": "a.c", "final_score": 70}))
+        self.assertFalse(self.queue.complete(task["id"], task["token"], {"file": "a.c", "final_score": 90}))
+        self.assertEqual(self.queue.counts()["done"], 1)
+        self.assertEqual(self.queue.summary()["mean_final_score"], 70)
+
+    def test_expired_lease_is_handed_on(self):
+        self.queue.enqueue(["a.c"])
+        lost = self.queue.lease("w1", lease_seconds=-1)
+        task = self.queue.lease("w2")
+        self.assertEqual((task["id"], task["attempts"]), (lost["id"], 2))
+        self.assertFalse(self.queue.renew(lost["id"], lost["token"]))
+        self.assertTrue(self.queue.renew(task["id"], task["token"]))
+        self.assertFalse(self.queue.complete(lost["id"], lost["token"], {"file": "a.c"}))
+
+    def test_lease_expiring_max_attempts_times_fails_the_task(self):
+        self.queue.enqueue(["a.c"])
+        self.queue.lease("w1", lease_seconds=-1)
+        self.queue.lease("w2", lease_seconds=-1)
+        self.assertIsNone(self.queue.lease("w3"))
+        self.assertEqual(self.queue.counts()["failed"], 1)
+        _, results = self.queue.results_since(0)
+        self.assertEqual(results, [({"file": "a.c", "error": "lease expired 2 times"}, None)])
+
+    def test_fail_retries_until_attempts_are_used_up(self):
+        self.queue.enqueue(["a.c"])
+        task = self.queue.lease("w1")
+        self.assertTrue(self.queue.fail(task["id"], task["token"], "worker crashed"))
+        self.assertEqual(self.queue.counts()["pending"], 1)
+        task = self.queue.lease("w1")
+        self.assertTrue(self.queue.fail(task["id"], task["token"], "worker crashed"))
+        self.assertEqual(self.queue.counts()["failed"], 1)
+        self.assertFalse(self.queue.fail(task["id"], task["token"], "worker crashed"))
+
+    def test_results_stream_in_completion_order_with_their_keys(self):
+        self.queue.enqueue(["a.c", "b.c", "c.c"])
+        a = self.queue.lease("w1")
+        b = self.queue.lease("w1")
+        self.assertTrue(self.queue.set_result_key(b["id"], b["token"], "key-b"))
+        self.assertFalse(self.queue.set_result_key(a["id"], "stale", "key-a"))
+        self.queue.complete(b["id"], b["token"], {"file": "b.c", "final_score": 60})
+        self.queue.complete(a["id"], a["token"], {"file": "a.c", "final_score": 80})
+        (c_id, _), = self.queue.pending()
+        self.queue.reuse(c_id, {"file": "c.c", "final_score": 40})
+
+        cursor, results = self.queue.results_since(0, limit=2)
+        self.assertEqual([(result["file"], key) for result, key in results], [("b.c", "key-b"), ("a.c", None)])
+        cursor, results = self.queue.results_since(cursor)
+        self.assertEqual(results, [({"file": "c.c", "final_score": 40, "reused": True}, None)])
+        self.assertEqual(self.queue.results_since(cursor), (cursor, []))
+        self.assertEqual(self.queue.summary()["reused"], 1)
+
+    def test_reopened_queue_resumes(self):
+        self.queue.enqueue(["a.c", "b.c"])
+        task = self.queue.lease("w1")
+        self.queue.complete(task["id"], task["token"], {"file": "a.c", "final_score": 75})
+        self.queue.close()
+
+        queue = self.open_queue()
+        self.assertEqual(queue.enqueue(["a.c", "b.c"]), 0)
+        self.assertEqual(queue.counts(), {"pending": 1, "leased": 0, "done": 1, "failed": 0})
+        self.assertEqual(queue.lease("w2")["path"], "b.c")
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,76 @@
+import unittest
+from unittest import mock
+
+import support  # noqa: F401
+import ratelimit
+from ratelimit import MIN_RATE_FRACTION, QUOTA_HEADROOM, RECOVERY_STEP, THROTTLE_FACTOR, TokenBucket
+
+
+class FakeClock:
+    # Stands in for time.monotonic and time.sleep so waits take no real time
+    def __init__(self):
+        self.now = 1000.0
+        self.slept = []
+
+    def monotonic(self):
+        return self.now
+
+    def sleep(self, seconds):
+        self.slept.append(seconds)
+        self.now += seconds
+
+
+class TokenBucketTest(unittest.TestCase):
+    def setUp(self):
+        self.clock = FakeClock()
+        patcher = mock.patch.multiple(ratelimit.time, monotonic=self.clock.monotonic, sleep=self.clock.sleep)
+        patcher.start()
+        self.addCleanup(patcher.stop)
+
+    def test_starts_full_at_headroom_quota(self):
+        bucket = TokenBucket(100)
+        self.assertAlmostEqual(bucket.quota, 100 * QUOTA_HEADROOM)
+        self.assertEqual(bucket.rate, bucket.quota)
+        bucket.acquire(bucket.quota)
+        self.assertEqual(self.clock.slept, [])
+
+    def test_waits_for_refill_when_empty(self):
+        bucket = TokenBucket(60 / QUOTA_HEADROOM)
+        bucket.acquire(60)
+        bucket.acquire(30)
+        # 30 tokens at 60 per minute
+        self.assertAlmostEqual(sum(self.clock.slept), 30.0)
+
+    def test_idle_time_does_not_overfill(self):
+        bucket = TokenBucket(60 / QUOTA_HEADROOM)
+        self.clock.now += 3600
+        bucket.acquire(1)
+        self.assertAlmostEqual(bucket.tokens, 59)
+
+    def test_oversized_request_waits_for_a_full_bucket(self):
+        bucket = TokenBucket(60 / QUOTA_HEADROOM)
+        bucket.acquire(60)
+        bucket.acquire(1000)
+        self.assertAlmostEqual(sum(self.clock.slept), 60.0)
+
+    def test_throttle_halves_rate_down_to_floor(self):
+        bucket = TokenBucket(100)
+        bucket.throttle()
+        self.assertAlmostEqual(bucket.rate, bucket.quota * THROTTLE_FACTOR)
+        self.assertLessEqual(bucket.tokens, bucket.rate)
+        for _ in range(20):
+            bucket.throttle()
+        self.assertAlmostEqual(bucket.rate, bucket.quota * MIN_RATE_FRACTION)
+
+    def test_recover_steps_back_up_to_quota(self):
+        bucket = TokenBucket(100)
+        bucket.throttle()
+        bucket.recover()
+        self.assertAlmostEqual(bucket.rate, bucket.quota * (THROTTLE_FACTOR + RECOVERY_STEP))
+        for _ in range(50):
+            bucket.recover()
+        self.assertAlmostEqual(bucket.rate, bucket.quota)
+
+
+if __name__ == '__main__':
+    unittest.main()